@@ -3,8 +3,12 @@
 #include "log_duration.h"
 #include "unit_test_tools.h"
 #include "search_server.h"
+#include "request_queue.h"
+#include "write_ahead_log.h"
+#include "string_processing.h"
 
 #include <execution>
+#include <filesystem>
 #include <iostream>
 #include <string>
 #include <string_view>
@@ -14,6 +18,7 @@
 namespace benchmark_tests {
 
 using namespace std::string_literals;
+using namespace std::string_view_literals;
 using namespace unit_test_tools;
 
 inline std::string GenerateWord(std::size_t max_length) {
@@ -59,15 +64,43 @@ inline std::string GenerateQuery(const std::vector<std::string>& dictionary,
 }
 
 inline std::vector<std::string> GenerateQueries(const std::vector<std::string>& dictionary,
-                                                std::size_t query_count, std::size_t max_word_count) {
+                                                std::size_t query_count, std::size_t max_word_count,
+                                                double minus_prob = 0) {
     std::vector<std::string> queries;
     queries.reserve(query_count);
     for (std::size_t i = 0; i < query_count; ++i) {
-        queries.push_back(GenerateQuery(dictionary, max_word_count));
+        queries.push_back(GenerateQuery(dictionary, max_word_count, minus_prob));
     }
     return queries;
 }
 
+// Words with smaller indices in the dictionary are more frequent, like in natural texts.
+inline std::string GenerateSkewedText(const std::vector<std::string>& dictionary, std::size_t max_word_count) {
+    assert(max_word_count > 0);
+
+    const auto word_count = Generator<std::size_t>::Get(1, max_word_count);
+    const std::size_t last_index = dictionary.size() - 1;
+    std::string text;
+    for (std::size_t i = 0; i < word_count; ++i) {
+        if (!text.empty()) {
+            text.push_back(' ');
+        }
+        const auto index = Generator<std::size_t>::Get(0, last_index) * Generator<std::size_t>::Get(0, last_index);
+        text += dictionary[last_index == 0 ? 0 : index / last_index];
+    }
+    return text;
+}
+
+inline std::vector<std::string> GenerateSkewedTexts(const std::vector<std::string>& dictionary,
+                                                    std::size_t text_count, std::size_t max_word_count) {
+    std::vector<std::string> texts;
+    texts.reserve(text_count);
+    for (std::size_t i = 0; i < text_count; ++i) {
+        texts.push_back(GenerateSkewedText(dictionary, max_word_count));
+    }
+    return texts;
+}
+
 struct SearchServerGenerator {
     inline static const auto dictionary = GenerateDictionary(1'000, 10);
     inline static const auto documents = GenerateQueries(dictionary, 10'000, 70);
@@ -84,8 +117,146 @@ inline const SearchServer const_search_server = [] {
     return search_server;
 }();
 
+inline const SearchServer skewed_search_server = [] {
+    SearchServer search_server(""s);
+    const auto documents = GenerateSkewedTexts(SearchServerGenerator::dictionary, 10'000, 70);
+    const std::vector<int> ratings = {1, 2, 3};
+    for (std::size_t i = 0; i < documents.size(); ++i) {
+        search_server.AddDocument(static_cast<int>(i), documents[i], DocumentStatus::ACTUAL, ratings);
+    }
+    return search_server;
+}();
+
+inline const SearchServer compressed_search_server = [] {
+    SearchServer search_server = const_search_server;
+    search_server.SetPostingListEncoding(PostingListEncoding::COMPRESSED);
+    return search_server;
+}();
+
 // BENCHMARK TESTS
 
+inline void TestAddDocuments(std::string_view mark) {
+    std::cerr << "Benchmarking of "s << mark <<" AddDocument:\n"s;
+    SearchServer search_server(SearchServerGenerator::dictionary[0]);
+    const std::vector<int> ratings = {1, 2, 3};
+    {
+        LOG_DURATION(mark);
+        for (std::size_t i = 0; i < SearchServerGenerator::documents.size(); ++i) {
+            search_server.AddDocument(static_cast<int>(i), SearchServerGenerator::documents[i],
+                                      DocumentStatus::ACTUAL, ratings);
+        }
+    }
+    std::cout << search_server.GetDocumentCount() << std::endl;
+}
+
+template<typename ExecutionPolicy>
+void TestAddDocuments(std::string_view mark, const ExecutionPolicy& policy) {
+    std::cerr << "Benchmarking of "s << mark <<" AddDocuments:\n"s;
+    SearchServer search_server(SearchServerGenerator::dictionary[0]);
+    std::vector<DocumentToAdd> documents;
+    for (std::size_t i = 0; i < SearchServerGenerator::documents.size(); ++i) {
+        documents.push_back({static_cast<int>(i), SearchServerGenerator::documents[i], DocumentStatus::ACTUAL,
+                             {1, 2, 3}});
+    }
+    {
+        LOG_DURATION(mark);
+        search_server.AddDocuments(policy, documents);
+    }
+    std::cout << search_server.GetDocumentCount() << std::endl;
+}
+
+// Small checkpoints over a server whose dictionary is much larger than the words of a checkpoint.
+template<typename AddDocuments>
+void TestAddDocumentsToLargeDictionary(std::string_view mark, AddDocuments add_documents) {
+    std::cerr << "Benchmarking of "s << mark <<" AddDocuments to a large dictionary:\n"s;
+    const auto large_dictionary = GenerateDictionary(200'000, 12);
+    std::string all_words;
+    for (const auto& word : large_dictionary) {
+        all_words += word;
+        all_words += ' ';
+    }
+    SearchServer search_server(""sv);
+    search_server.AddDocument(0, all_words, DocumentStatus::ACTUAL, {1});
+    std::vector<DocumentToAdd> documents;
+    for (std::size_t i = 0; i < SearchServerGenerator::documents.size(); ++i) {
+        documents.push_back({static_cast<int>(i) + 1, SearchServerGenerator::documents[i], DocumentStatus::ACTUAL,
+                             {1, 2, 3}});
+    }
+    {
+        LOG_DURATION(mark);
+        add_documents(search_server, documents);
+    }
+    std::cout << search_server.GetDocumentCount() << std::endl;
+}
+
+inline void TestAddDocumentsWithLog(std::string_view mark, std::size_t group_commit_byte_count) {
+    const auto path = (std::filesystem::temp_directory_path() / "search_server_benchmark.log"s).string();
+    std::filesystem::remove(path);
+    std::cerr << "Benchmarking of "s << mark <<" AddDocument with WriteAheadLog:\n"s;
+    SearchServer search_server(SearchServerGenerator::dictionary[0]);
+    {
+        WriteAheadLog log(path, group_commit_byte_count);
+        search_server.AttachWriteAheadLog(&log);
+        const std::vector<int> ratings = {1, 2, 3};
+        LOG_DURATION(mark);
+        for (std::size_t i = 0; i < SearchServerGenerator::documents.size(); ++i) {
+            search_server.AddDocument(static_cast<int>(i), SearchServerGenerator::documents[i],
+                                      DocumentStatus::ACTUAL, ratings);
+        }
+        log.Commit();
+        search_server.AttachWriteAheadLog(nullptr);
+    }
+    std::cout << search_server.GetDocumentCount() << std::endl;
+    std::filesystem::remove(path);
+}
+
+inline void TestLoadIndex(std::string_view mark) {
+    const auto path = (std::filesystem::temp_directory_path() / "search_server_benchmark.index"s).string();
+    const_search_server.SaveIndex(path);
+    std::cerr << "Benchmarking of "s << mark <<" LoadIndex:\n"s;
+    {
+        LOG_DURATION(mark);
+        const auto search_server = SearchServer::LoadIndex(path);
+        std::cout << search_server.GetDocumentCount() << std::endl;
+    }
+    std::filesystem::remove(path);
+}
+
+// `split` returns the number of words of the text.
+template<typename Split>
+void TestSplitIntoWords(std::string_view mark, Split split) {
+    std::cerr << "Benchmarking of "s << mark <<" SplitIntoWordsView:\n"s;
+    {
+        LOG_DURATION(mark);
+        std::size_t word_count = 0;
+        for (int i = 0; i < 10; ++i) {
+            for (const auto& document : SearchServerGenerator::documents) {
+                word_count += split(document);
+            }
+        }
+        std::cout << word_count << std::endl;
+    }
+}
+
+// The previous tokenizer: words are searched for by `find`, then control characters by a separate pass.
+inline std::vector<std::string_view> SplitIntoWordsByFind(std::string_view text) {
+    std::vector<std::string_view> words;
+    for (auto pos = text.find_first_not_of(' '); pos != std::string_view::npos;
+            pos = text.find_first_not_of(' ', pos)) {
+        const auto end = std::min(text.find(' ', pos), text.size());
+        words.push_back(text.substr(pos, end - pos));
+        pos = end;
+    }
+    for (const auto word : words) {
+        if (std::any_of(word.begin(), word.end(), [](const char c) {
+            return iscntrl(static_cast<unsigned char>(c));
+        })) {
+            throw std::invalid_argument("Forbidden characters"s);
+        }
+    }
+    return words;
+}
+
 template<typename ExecutionPolicy>
 void TestRemoveDocument(std::string_view mark, const ExecutionPolicy& policy) {
     SearchServer search_server = const_search_server;
@@ -100,6 +271,65 @@ void TestRemoveDocument(std::string_view mark, const ExecutionPolicy& policy) {
     }
 }
 
+template<typename ExecutionPolicy>
+void TestCompactIndex(std::string_view mark, const ExecutionPolicy& policy) {
+    SearchServer search_server = const_search_server;
+    // A tenth of the corpus is churned.
+    const int document_count = search_server.GetDocumentCount();
+    for (int id = 0; id < document_count; id += 10) {
+        search_server.RemoveDocument(id);
+    }
+    std::cerr << "Benchmarking of "s << mark <<" CompactIndex:\n"s;
+    {
+        LOG_DURATION(mark);
+        search_server.CompactIndex(policy);
+        std::cout << search_server.FindTopDocuments(SearchServerGenerator::query).size() << std::endl;
+    }
+}
+
+// A third of the corpus is purged either one by one or in a batch, so posting lists cross
+// the compaction threshold.
+template<typename RemoveDocuments>
+void TestRemoveDocuments(std::string_view mark, RemoveDocuments remove_documents) {
+    SearchServer search_server = const_search_server;
+    std::vector<int> document_ids;
+    for (int id = 0; id < search_server.GetDocumentCount(); id += 3) {
+        document_ids.push_back(id);
+    }
+    std::cerr << "Benchmarking of "s << mark <<" RemoveDocuments:\n"s;
+    {
+        LOG_DURATION(mark);
+        remove_documents(search_server, document_ids);
+        std::cout << search_server.GetDocumentCount() << std::endl;
+    }
+}
+
+// Every day a tenth of the corpus is replaced with new documents, then the day's queries are run.
+inline void TestChurn(std::string_view mark, double max_removed_share) {
+    SearchServer search_server = const_search_server;
+    search_server.SetCompactionThresholds(max_removed_share, max_removed_share);
+    const auto& documents = SearchServerGenerator::documents;
+    const int churn_count = static_cast<int>(documents.size()) / 10;
+    std::cerr << "Benchmarking of "s << mark <<" churn:\n"s;
+    {
+        LOG_DURATION(mark);
+        std::size_t found_count = 0;
+        for (int day = 0; day < 10; ++day) {
+            for (int i = 0; i < churn_count; ++i) {
+                const int document_id = day * churn_count + i;
+                search_server.RemoveDocument(document_id);
+                search_server.AddDocument(document_id + static_cast<int>(documents.size()),
+                                          documents[static_cast<std::size_t>(document_id) % documents.size()],
+                                          DocumentStatus::ACTUAL, {1, 2, 3});
+            }
+            for (int i = 0; i < 10; ++i) {
+                found_count += search_server.FindTopDocuments(SearchServerGenerator::query).size();
+            }
+        }
+        std::cout << found_count << std::endl;
+    }
+}
+
 template<typename ExecutionPolicy>
 void TestMatchDocument(std::string_view mark, const ExecutionPolicy& policy) {
     const SearchServer& search_server = const_search_server;
@@ -116,11 +346,63 @@ void TestMatchDocument(std::string_view mark, const ExecutionPolicy& policy) {
     }
 }
 
+inline void TestMatchDocumentPrepared(std::string_view mark) {
+    const SearchServer& search_server = const_search_server;
+    std::cerr << "Benchmarking of "s << mark <<" MatchDocument:\n"s;
+    {
+        LOG_DURATION(mark);
+        const auto prepared_query = search_server.PrepareQuery(SearchServerGenerator::query);
+        const int document_count = search_server.GetDocumentCount();
+        int word_count = 0;
+        for (int id = 0; id < document_count; ++id) {
+            const auto& [words, status] = search_server.MatchDocument(prepared_query, id);
+            word_count += words.size();
+        }
+        std::cout << word_count << std::endl;
+    }
+}
+
 template<typename ExecutionPolicy>
-void TestFindTopDocuments(std::string_view mark, const ExecutionPolicy& policy) {
+void TestMatchDocuments(std::string_view mark, const ExecutionPolicy& policy) {
     const SearchServer& search_server = const_search_server;
+    std::cerr << "Benchmarking of "s << mark <<" MatchDocuments:\n"s;
+    {
+        LOG_DURATION(mark);
+        int word_count = 0;
+        for (const auto& [words, status] : search_server.MatchDocuments(policy, SearchServerGenerator::query,
+                                                                        search_server)) {
+            word_count += words.size();
+        }
+        std::cout << word_count << std::endl;
+    }
+}
+
+// Every query is executed several times, as with paginated results.
+inline void TestFindTopDocumentsPrepared(std::string_view mark, bool is_prepared) {
+    const SearchServer& search_server = skewed_search_server;
+    const auto queries = GenerateSkewedTexts(SearchServerGenerator::dictionary, 100, 70);
+    std::cerr << "Benchmarking of "s << mark <<" FindTopDocuments:\n"s;
+    {
+        LOG_DURATION(mark);
+        double total_relevance = 0.0;
+        for (const auto& query : queries) {
+            const auto prepared_query = search_server.PrepareQuery(query);
+            for (int i = 0; i < 5; ++i) {
+                const auto documents = is_prepared ? search_server.FindTopDocuments(prepared_query)
+                                                   : search_server.FindTopDocuments(query);
+                for (const auto& document : documents) {
+                    total_relevance += document.relevance;
+                }
+            }
+        }
+        std::cout << total_relevance << std::endl;
+    }
+}
+
+template<typename ExecutionPolicy>
+void TestFindTopDocuments(std::string_view mark, const ExecutionPolicy& policy,
+                          const SearchServer& search_server, const std::vector<std::string>& queries) {
     std::cerr << "Benchmarking of "s << mark <<" FindTopDocuments:\n"s;
-    const auto queries = GenerateQueries(SearchServerGenerator::dictionary, 100, 70);
     {
         LOG_DURATION(mark);
         double total_relevance = 0.0;
@@ -133,17 +415,168 @@ void TestFindTopDocuments(std::string_view mark, const ExecutionPolicy& policy)
     }
 }
 
+template<typename ExecutionPolicy>
+void TestFindTopDocuments(std::string_view mark, const ExecutionPolicy& policy,
+                          const SearchServer& search_server = const_search_server, double minus_prob = 0) {
+    TestFindTopDocuments(mark, policy, search_server,
+                         GenerateQueries(SearchServerGenerator::dictionary, 100, 70, minus_prob));
+}
+
+template<typename ExecutionPolicy>
+void TestFindTopDocumentsSkewed(std::string_view mark, const ExecutionPolicy& policy) {
+    TestFindTopDocuments(mark, policy, skewed_search_server,
+                         GenerateSkewedTexts(SearchServerGenerator::dictionary, 100, 70));
+}
+
+// Requests repeat popular queries: the query of a request is drawn from skewed distribution.
+inline void TestResultCache(std::string_view mark, std::size_t cache_capacity) {
+    SearchServer search_server = const_search_server;
+    if (cache_capacity > 0) {
+        search_server.EnableResultCache(cache_capacity);
+    }
+    const auto queries = GenerateQueries(SearchServerGenerator::dictionary, 1'000, 20);
+    std::vector<std::size_t> requests(2'000);
+    for (auto& query_index : requests) {
+        query_index = Generator<std::size_t>::Get(0, queries.size() - 1)
+                      * Generator<std::size_t>::Get(0, queries.size() - 1)
+                      * Generator<std::size_t>::Get(0, queries.size() - 1) / queries.size() / queries.size();
+    }
+
+    RequestQueue request_queue(search_server);
+    std::cerr << "Benchmarking of "s << mark << " RequestQueue::AddFindRequest:\n"s;
+    {
+        LOG_DURATION(mark);
+        for (const std::size_t query_index : requests) {
+            (void) request_queue.AddFindRequest(queries[query_index]);
+        }
+        std::cout << request_queue.GetNoResultRequests() << std::endl;
+    }
+    const auto statistics = search_server.GetResultCacheStatistics();
+    std::cerr << "hits: "s << statistics.hit_count << ", misses: "s << statistics.miss_count << '\n';
+}
+
+// Times every execution of `search_execution::adaptive` on queries of growing cost:
+// the posting count where parallel executions overtake the sequential one is `min_parallel_posting_count`.
+inline void CalibrateAdaptivePolicy(std::string_view mark, const SearchServer& search_server) {
+    for (const std::size_t word_count : {1u, 2u, 4u, 8u, 16u, 32u, 70u}) {
+        std::vector<std::string> queries;
+        std::size_t posting_count = 0;
+        for (int i = 0; i < 100; ++i) {
+            queries.push_back(GenerateQuery(SearchServerGenerator::dictionary, word_count));
+            posting_count += search_server.EstimateQueryCost(queries.back()).posting_count;
+        }
+        std::cerr << "Calibration of "s << mark << " adaptive policy on "s << word_count << " words, "s
+                  << posting_count / queries.size() << " postings per query:\n"s;
+        const auto run = [&search_server, &queries](std::string_view execution, const auto& policy) {
+            LOG_DURATION(execution);
+            double total_relevance = 0.0;
+            for (const auto& query : queries) {
+                for (const auto& document : search_server.FindTopDocuments(policy, query)) {
+                    total_relevance += document.relevance;
+                }
+            }
+            std::cout << total_relevance << std::endl;
+        };
+        run("seq"sv, std::execution::seq);
+        run("terms"sv, search_execution::par_pool);
+        run("document ranges"sv, search_execution::par_document_ranges);
+        run("adaptive"sv, search_execution::adaptive);
+    }
+}
+
 } // namespace benchmark_tests
 
 inline void RunAllBenchmarkTests() {
     using namespace benchmark_tests;
 
+    TestSplitIntoWords("find", [](std::string_view text) {
+        return SplitIntoWordsByFind(text).size();
+    });
+    TestSplitIntoWords("vectorized", [](std::string_view text) {
+        bool has_control_chars = false;
+        const auto words = SplitIntoWordsView(text, &has_control_chars);
+        if (has_control_chars) {
+            throw std::invalid_argument("Forbidden characters"s);
+        }
+        return words.size();
+    });
+    TestSplitIntoWords("lazy", [](std::string_view text) {
+        const WordRange words(text);
+        const auto word_count = static_cast<std::size_t>(std::distance(words.begin(), words.end()));
+        if (words.HasControlChars()) {
+            throw std::invalid_argument("Forbidden characters"s);
+        }
+        return word_count;
+    });
+
+    TestAddDocuments("one by one");
+    TestAddDocuments("seq", std::execution::seq);
+    TestAddDocuments("par pool", search_execution::par_pool);
+    TestAddDocuments("8 document ranges", search_execution::DocumentRangePolicy{8});
+    TestAddDocumentsToLargeDictionary("one by one", [](SearchServer& search_server,
+                                                       const std::vector<DocumentToAdd>& documents) {
+        for (const auto& document : documents) {
+            search_server.AddDocument(document.id, document.text, document.status, document.ratings);
+        }
+    });
+    TestAddDocumentsToLargeDictionary("seq, checkpoints of 10", [](SearchServer& search_server,
+                                                                   const std::vector<DocumentToAdd>& documents) {
+        search_server.AddDocuments(std::execution::seq, documents, 10);
+    });
+    TestAddDocumentsToLargeDictionary("par pool, checkpoints of 10", [](SearchServer& search_server,
+                                                                        const std::vector<DocumentToAdd>& documents) {
+        search_server.AddDocuments(search_execution::par_pool, documents, 10);
+    });
+    TestAddDocumentsWithLog("group commit", WriteAheadLog::DEFAULT_GROUP_COMMIT_BYTE_COUNT);
+    TestAddDocumentsWithLog("commit per 4 KiB", 4'096);
+    TestLoadIndex("mapped");
+
     TestRemoveDocument("seq", std::execution::seq);
     TestRemoveDocument("par", std::execution::par);
+    TestRemoveDocument("par pool", search_execution::par_pool);
+    TestCompactIndex("seq", std::execution::seq);
+    TestCompactIndex("par pool", search_execution::par_pool);
+    TestRemoveDocuments("one by one", [](SearchServer& search_server, const std::vector<int>& document_ids) {
+        for (const int document_id : document_ids) {
+            search_server.RemoveDocument(document_id);
+        }
+    });
+    TestRemoveDocuments("seq", [](SearchServer& search_server, const std::vector<int>& document_ids) {
+        search_server.RemoveDocuments(std::execution::seq, document_ids);
+    });
+    TestRemoveDocuments("par pool", [](SearchServer& search_server, const std::vector<int>& document_ids) {
+        search_server.RemoveDocuments(search_execution::par_pool, document_ids);
+    });
+    TestChurn("uncompacted", 1.0);
+    TestChurn("compacted by thresholds", SearchServer::DEFAULT_MAX_REMOVED_POSTING_SHARE);
 
     TestMatchDocument("seq", std::execution::seq);
     TestMatchDocument("par", std::execution::par);
+    TestMatchDocument("par pool", search_execution::par_pool);
+    TestMatchDocument("adaptive", search_execution::adaptive);
+    TestMatchDocumentPrepared("prepared");
+    TestMatchDocuments("seq", std::execution::seq);
+    TestMatchDocuments("par pool", search_execution::par_pool);
 
     TestFindTopDocuments("seq", std::execution::seq);
     TestFindTopDocuments("par", std::execution::par);
+    TestFindTopDocuments("par pool", search_execution::par_pool);
+    TestFindTopDocuments("par document ranges", search_execution::par_document_ranges);
+    TestFindTopDocuments("adaptive", search_execution::adaptive);
+    TestFindTopDocuments("seq compressed", std::execution::seq, compressed_search_server);
+    TestFindTopDocuments("seq minus words", std::execution::seq, const_search_server, 0.1);
+    TestFindTopDocuments("par minus words", std::execution::par, const_search_server, 0.1);
+    TestFindTopDocumentsSkewed("seq skewed", std::execution::seq);
+    TestFindTopDocumentsSkewed("par skewed", std::execution::par);
+    TestFindTopDocumentsSkewed("par pool skewed", search_execution::par_pool);
+    TestFindTopDocumentsSkewed("par document ranges skewed", search_execution::par_document_ranges);
+    TestFindTopDocumentsSkewed("adaptive skewed", search_execution::adaptive);
+    TestFindTopDocumentsPrepared("raw repeated skewed", false);
+    TestFindTopDocumentsPrepared("prepared repeated skewed", true);
+
+    TestResultCache("uncached", 0);
+    TestResultCache("cached", 100);
+
+    CalibrateAdaptivePolicy("uniform", const_search_server);
+    CalibrateAdaptivePolicy("skewed", skewed_search_server);
 }
\ No newline at end of file
@@ -0,0 +1,113 @@
+#include "bit_packing.h"
+
+#include <algorithm>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace bit_packing {
+
+namespace {
+
+constexpr std::uint32_t VALUES_PER_LANE = BLOCK_SIZE / LANE_COUNT;
+
+constexpr std::uint32_t LowBitsMask(std::uint32_t bit_width) noexcept {
+    return bit_width == 32 ? ~std::uint32_t(0) : (std::uint32_t(1) << bit_width) - 1;
+}
+
+#ifndef __SSE2__
+void UnpackLane(const std::uint32_t* in, std::uint32_t bit_width, std::size_t lane, std::uint32_t* values) noexcept {
+    const std::uint32_t mask = LowBitsMask(bit_width);
+    std::uint32_t shift = 0;
+    std::size_t word = 0;
+    for (std::uint32_t k = 0; k < VALUES_PER_LANE; ++k) {
+        std::uint32_t value = in[word * LANE_COUNT + lane] >> shift;
+        if (shift + bit_width > 32) {
+            value |= in[(word + 1) * LANE_COUNT + lane] << (32 - shift);
+        }
+        values[k * LANE_COUNT + lane] = value & mask;
+        shift += bit_width;
+        if (shift >= 32) {
+            shift -= 32;
+            ++word;
+        }
+    }
+}
+#endif
+
+} // namespace
+
+[[nodiscard]] std::uint32_t RequiredBitWidth(const std::uint32_t* values, std::size_t count) noexcept {
+    std::uint32_t accumulated = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        accumulated |= values[i];
+    }
+    std::uint32_t bit_width = 0;
+    while (accumulated != 0) {
+        ++bit_width;
+        accumulated >>= 1;
+    }
+    return bit_width;
+}
+
+void PackBlock(const std::uint32_t* values, std::uint32_t bit_width, std::uint32_t* out) noexcept {
+    std::fill(out, out + PackedBlockWordCount(bit_width), 0);
+    if (bit_width == 0) {
+        return;
+    }
+
+    for (std::size_t lane = 0; lane < LANE_COUNT; ++lane) {
+        std::uint32_t shift = 0;
+        std::size_t word = 0;
+        for (std::uint32_t k = 0; k < VALUES_PER_LANE; ++k) {
+            const std::uint32_t value = values[k * LANE_COUNT + lane];
+            out[word * LANE_COUNT + lane] |= value << shift;
+            if (shift + bit_width > 32) {
+                out[(word + 1) * LANE_COUNT + lane] |= value >> (32 - shift);
+            }
+            shift += bit_width;
+            if (shift >= 32) {
+                shift -= 32;
+                ++word;
+            }
+        }
+    }
+}
+
+void UnpackBlock(const std::uint32_t* in, std::uint32_t bit_width, std::uint32_t* values) noexcept {
+    if (bit_width == 0) {
+        std::fill(values, values + BLOCK_SIZE, 0);
+        return;
+    }
+
+#ifdef __SSE2__
+    // All four lanes are decoded at once: one 128-bit word holds a 32-bit word of every lane.
+    const __m128i mask = _mm_set1_epi32(static_cast<int>(LowBitsMask(bit_width)));
+    const auto* source = reinterpret_cast<const __m128i*>(in);
+    auto* destination = reinterpret_cast<__m128i*>(values);
+
+    __m128i current = _mm_loadu_si128(source++);
+    std::uint32_t shift = 0;
+    for (std::uint32_t k = 0; k < VALUES_PER_LANE; ++k) {
+        __m128i value = _mm_srl_epi32(current, _mm_cvtsi32_si128(static_cast<int>(shift)));
+        shift += bit_width;
+        // The last value of a lane always ends on the boundary of the last word.
+        if (shift >= 32 && k + 1 < VALUES_PER_LANE) {
+            shift -= 32;
+            current = _mm_loadu_si128(source++);
+            if (shift > 0) {
+                const auto spilled_bits = _mm_cvtsi32_si128(static_cast<int>(bit_width - shift));
+                value = _mm_or_si128(value, _mm_sll_epi32(current, spilled_bits));
+            }
+        }
+        _mm_storeu_si128(destination++, _mm_and_si128(value, mask));
+    }
+#else
+    for (std::size_t lane = 0; lane < LANE_COUNT; ++lane) {
+        UnpackLane(in, bit_width, lane, values);
+    }
+#endif
+}
+
+} // namespace bit_packing
\ No newline at end of file
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/// Bit packing of blocks of 128 unsigned 32-bit integers in the layout of SIMD-BP128:
+/// value `i` belongs to lane `i % 4`, every lane is a stream of 32-bit words,
+/// and the words of the four lanes are interleaved, so one 128-bit register
+/// decodes four values at once.
+namespace bit_packing {
+
+inline constexpr std::size_t BLOCK_SIZE = 128;
+inline constexpr std::size_t LANE_COUNT = 4;
+
+/// Returns the number of bits needed to store the largest of `count` values.
+[[nodiscard]] std::uint32_t RequiredBitWidth(const std::uint32_t* values, std::size_t count) noexcept;
+
+/// Returns the number of 32-bit words taken by a block packed with `bit_width` bits per value.
+[[nodiscard]] constexpr std::size_t PackedBlockWordCount(std::uint32_t bit_width) noexcept {
+    return LANE_COUNT * bit_width;
+}
+
+/// Packs `BLOCK_SIZE` values into `PackedBlockWordCount(bit_width)` words of `out`.
+/// Every value must fit into `bit_width` bits.
+void PackBlock(const std::uint32_t* values, std::uint32_t bit_width, std::uint32_t* out) noexcept;
+
+/// Unpacks `BLOCK_SIZE` values packed by `PackBlock`.
+void UnpackBlock(const std::uint32_t* in, std::uint32_t bit_width, std::uint32_t* values) noexcept;
+
+} // namespace bit_packing
\ No newline at end of file
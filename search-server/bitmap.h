@@ -0,0 +1,88 @@
+#pragma once
+
+#include "index_file.h"
+
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+/// Dense set of non-negative integers stored as one bit per integer.
+/// Bits beyond `size()` are treated as unset, so testing them is allowed.
+class Bitmap {
+public:
+    Bitmap() noexcept = default;
+
+    explicit Bitmap(std::size_t size)
+            : size_(size)
+            , words_((size + WORD_BIT_COUNT - 1) / WORD_BIT_COUNT) {
+    }
+
+    // Capacity
+
+    [[nodiscard]] std::size_t size() const noexcept {
+        return size_;
+    }
+
+    void Resize(std::size_t size) {
+        size_ = size;
+        words_.resize((size + WORD_BIT_COUNT - 1) / WORD_BIT_COUNT);
+        // Bits cut off by shrinking are cleared, so they don't reappear on growing.
+        if (size % WORD_BIT_COUNT != 0) {
+            words_.back() &= (Word(1) << (size % WORD_BIT_COUNT)) - 1;
+        }
+    }
+
+    // Lookup
+
+    [[nodiscard]] bool Test(std::size_t pos) const noexcept {
+        const std::size_t word = pos / WORD_BIT_COUNT;
+        return word < words_.size() && ((words_[word] >> (pos % WORD_BIT_COUNT)) & 1) != 0;
+    }
+
+    // Modification
+
+    /// Grows the bitmap if `pos` is out of its size.
+    void Set(std::size_t pos) {
+        if (pos >= size_) {
+            Resize(pos + 1);
+        }
+        words_[pos / WORD_BIT_COUNT] |= Word(1) << (pos % WORD_BIT_COUNT);
+    }
+
+    void Reset(std::size_t pos) noexcept {
+        if (pos < size_) {
+            words_[pos / WORD_BIT_COUNT] &= ~(Word(1) << (pos % WORD_BIT_COUNT));
+        }
+    }
+
+    // Serialization
+
+    void Write(index_file::IndexWriter& writer) const {
+        writer.WriteValue(static_cast<std::uint64_t>(size_));
+        writer.WriteArray(words_);
+    }
+
+    [[nodiscard]] static Bitmap Read(index_file::IndexReader& reader) {
+        const auto size = reader.ReadValue<std::uint64_t>();
+        auto words = reader.ReadArray<Word>();
+        // Bits past the size must be clear, otherwise `Test` would report them and growing would expose them.
+        if (words.size() != (size + WORD_BIT_COUNT - 1) / WORD_BIT_COUNT
+                || (size % WORD_BIT_COUNT != 0 && words.back() >> (size % WORD_BIT_COUNT) != 0)) {
+            throw std::invalid_argument("Index file has an inconsistent bitmap");
+        }
+        Bitmap bitmap;
+        bitmap.size_ = static_cast<std::size_t>(size);
+        bitmap.words_ = std::move(words);
+        return bitmap;
+    }
+
+private:
+    using Word = std::uint64_t;
+
+    inline static constexpr std::size_t WORD_BIT_COUNT = 64;
+
+    std::size_t size_ = 0;
+    std::vector<Word> words_;
+};
\ No newline at end of file
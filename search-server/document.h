@@ -1,6 +1,8 @@
 #pragma once
 
 #include <ostream>
+#include <string_view>
+#include <vector>
 
 enum class DocumentStatus {
     ACTUAL,
@@ -19,4 +21,12 @@ struct Document {
     double relevance = 0.0;
 };
 
+/// A document of a batch added by `SearchServer::AddDocuments`; the text must outlive the call.
+struct DocumentToAdd {
+    int id = 0;
+    std::string_view text;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    std::vector<int> ratings;
+};
+
 std::ostream& operator<<(std::ostream& output, const Document& document);
\ No newline at end of file
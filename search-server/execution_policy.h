@@ -0,0 +1,135 @@
+#pragma once
+
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <execution>
+#include <numeric>
+#include <thread>
+#include <vector>
+#include <cstddef>
+
+/// Execution policies of SearchServer in addition to the standard ones.
+namespace search_execution {
+
+/// Parallel execution on a `ThreadPool` instead of the parallel backend of the standard library,
+/// so all parallel work of the process shares a bounded number of threads.
+struct ThreadPoolPolicy {
+    // Null means the process-wide pool.
+    ThreadPool* pool = nullptr;
+
+    [[nodiscard]] ThreadPool& GetPool() const {
+        return pool != nullptr ? *pool : ThreadPool::GetDefault();
+    }
+};
+
+inline constexpr ThreadPoolPolicy par_pool{};
+
+/// Intra-query parallelism by documents: the ordinals of documents are split into ranges,
+/// each range is scored by all query terms on its own worker, then the most relevant documents
+/// of the ranges are merged. Unlike `std::execution::par`, which parallelizes by query terms,
+/// the speedup doesn't depend on the number of query terms and their frequencies.
+/// Ranges are scored on the process-wide `ThreadPool`.
+struct DocumentRangePolicy {
+    // Zero means one range per worker of the process-wide pool.
+    std::size_t range_count = 0;
+};
+
+inline constexpr DocumentRangePolicy par_document_ranges{};
+
+/// Chooses the execution of every call from its estimated cost: cheap calls run on the calling thread,
+/// since handing them over to workers takes longer than the work itself.
+/// The defaults are calibrated by `CalibrateAdaptivePolicy` of `benchmark_tests.h`.
+struct AdaptivePolicy {
+    // A query whose plus terms have fewer postings in total is scored sequentially.
+    std::size_t min_parallel_posting_count = 4'096;
+    // The plus terms are shared among the workers only if the longest posting list is at most
+    // that many times longer than the postings per worker and there are fewer postings than documents,
+    // since partial relevances of the workers are merged by documents;
+    // otherwise documents are split into ranges.
+    double max_term_imbalance = 1.5;
+    // A query with fewer words is matched with a document sequentially.
+    std::size_t min_parallel_match_term_count = 1'000;
+};
+
+inline constexpr AdaptivePolicy adaptive{};
+
+/// Estimated cost of scoring a query.
+struct QueryCost {
+    std::size_t term_count = 0;
+    // Postings of the plus terms in total.
+    std::size_t posting_count = 0;
+    // Postings of the most frequent plus term.
+    std::size_t max_posting_count = 0;
+    std::size_t document_count = 0;
+};
+
+enum class QueryExecution {
+    SEQUENTIAL,
+    TERMS,
+    DOCUMENT_RANGES,
+};
+
+[[nodiscard]] inline QueryExecution ChooseQueryExecution(const AdaptivePolicy& policy, const QueryCost& cost,
+                                                         std::size_t worker_count) noexcept {
+    if (worker_count < 2 || cost.posting_count < policy.min_parallel_posting_count) {
+        return QueryExecution::SEQUENTIAL;
+    }
+    const double postings_per_worker = static_cast<double>(cost.posting_count) / static_cast<double>(worker_count);
+    if (cost.term_count >= worker_count && cost.posting_count <= cost.document_count
+            && static_cast<double>(cost.max_posting_count) <= policy.max_term_imbalance * postings_per_worker) {
+        return QueryExecution::TERMS;
+    }
+    return QueryExecution::DOCUMENT_RANGES;
+}
+
+// Number of workers executing in parallel with the policy.
+
+[[nodiscard]] inline std::size_t GetWorkerCount(const std::execution::sequenced_policy&) noexcept {
+    return 1;
+}
+
+[[nodiscard]] inline std::size_t GetWorkerCount(const std::execution::parallel_policy&) noexcept {
+    return std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+[[nodiscard]] inline std::size_t GetWorkerCount(const ThreadPoolPolicy& policy) {
+    // The calling thread works too.
+    return policy.GetPool().GetThreadCount() + 1;
+}
+
+[[nodiscard]] inline std::size_t GetWorkerCount(const DocumentRangePolicy& policy) {
+    return policy.range_count > 0 ? policy.range_count : GetWorkerCount(par_pool);
+}
+
+[[nodiscard]] inline std::size_t GetWorkerCount(const AdaptivePolicy&) {
+    return GetWorkerCount(par_pool);
+}
+
+// Calls `func(index)` for every index in [0, `count`) as the policy prescribes.
+
+template<typename Func>
+void ParallelFor(const std::execution::sequenced_policy&, std::size_t count, Func func) {
+    for (std::size_t index = 0; index < count; ++index) {
+        func(index);
+    }
+}
+
+template<typename Func>
+void ParallelFor(const std::execution::parallel_policy& policy, std::size_t count, Func func) {
+    std::vector<std::size_t> indices(count);
+    std::iota(indices.begin(), indices.end(), 0);
+    std::for_each(policy, indices.begin(), indices.end(), func);
+}
+
+template<typename Func>
+void ParallelFor(const ThreadPoolPolicy& policy, std::size_t count, Func func) {
+    policy.GetPool().ParallelFor(count, func);
+}
+
+template<typename Func>
+void ParallelFor(const DocumentRangePolicy&, std::size_t count, Func func) {
+    ParallelFor(par_pool, count, func);
+}
+
+} // namespace search_execution
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <cstddef>
+
+/// Mixes `value` into `hash`, so that equal sequences of values give equal hashes
+/// and the order of the values matters.
+inline void HashCombine(std::size_t& hash, std::size_t value) noexcept {
+    hash ^= value + 0x9e3779b97f4a7c15 + (hash << 6) + (hash >> 2);
+}
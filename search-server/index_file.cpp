@@ -0,0 +1,163 @@
+#include "index_file.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace index_file {
+
+using namespace std::string_literals;
+
+namespace {
+
+constexpr char MAGIC[8] = {'S', 'S', 'I', 'N', 'D', 'E', 'X', '\0'};
+// Tells a file written on a machine with another byte order.
+constexpr std::uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+// Waits until the file or the directory entries are durable.
+void SyncPath(const std::string& path, int flags) {
+    const int fd = open(path.c_str(), flags);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open "s + path + " for syncing"s);
+    }
+    const bool is_synced = fsync(fd) == 0;
+    close(fd);
+    if (!is_synced) {
+        throw std::runtime_error("Cannot sync "s + path);
+    }
+}
+
+} // namespace
+
+// IndexWriter
+
+IndexWriter::IndexWriter(const std::string& path)
+        : path_(path)
+        , temp_path_(path + ".tmp"s)
+        , output_(temp_path_, std::ios::binary | std::ios::trunc) {
+    if (!output_) {
+        throw std::runtime_error("Cannot open index file "s + temp_path_ + " for writing"s);
+    }
+    WriteBytes(MAGIC, sizeof(MAGIC));
+    WriteValue(VERSION);
+    WriteValue(BYTE_ORDER_MARK);
+}
+
+IndexWriter::~IndexWriter() {
+    if (!is_finished_) {
+        output_.close();
+        unlink(temp_path_.c_str());
+    }
+}
+
+void IndexWriter::Finish() {
+    output_.close();
+    if (!output_) {
+        throw std::runtime_error("Cannot write index file "s + temp_path_);
+    }
+    SyncPath(temp_path_, O_RDONLY);
+    if (rename(temp_path_.c_str(), path_.c_str()) != 0) {
+        throw std::runtime_error("Cannot rename index file "s + temp_path_ + " to "s + path_);
+    }
+    is_finished_ = true;
+    // The rename itself is durable only once the directory is synced.
+    const auto directory = std::filesystem::path(path_).parent_path();
+    SyncPath(directory.empty() ? "."s : directory.string(), O_RDONLY | O_DIRECTORY);
+}
+
+void IndexWriter::WriteBytes(const void* data, std::size_t size) {
+    output_.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+    size_ += size;
+}
+
+void IndexWriter::Align() {
+    static constexpr char padding[ALIGNMENT] = {};
+    WriteBytes(padding, (ALIGNMENT - size_ % ALIGNMENT) % ALIGNMENT);
+}
+
+// IndexReader
+
+IndexReader::IndexReader(const std::string& path)
+        : mapping_(path) {
+    if (std::memcmp(ReadBytes(sizeof(MAGIC)), MAGIC, sizeof(MAGIC)) != 0) {
+        throw std::invalid_argument("Not an index file: "s + path);
+    }
+    if (ReadValue<std::uint32_t>() != VERSION) {
+        throw std::invalid_argument("Unsupported version of index file "s + path);
+    }
+    if (ReadValue<std::uint32_t>() != BYTE_ORDER_MARK) {
+        throw std::invalid_argument("Index file "s + path + " has another byte order"s);
+    }
+}
+
+IndexReader::Mapping::Mapping(const std::string& path) {
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open index file "s + path);
+    }
+    struct stat file_status{};
+    if (fstat(fd, &file_status) != 0) {
+        close(fd);
+        throw std::runtime_error("Cannot get the size of index file "s + path);
+    }
+    size = static_cast<std::size_t>(file_status.st_size);
+    if (size > 0) {
+        void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED) {
+            close(fd);
+            throw std::runtime_error("Cannot map index file "s + path);
+        }
+        // Arrays are read from the beginning to the end.
+        (void) madvise(mapped, size, MADV_SEQUENTIAL);
+        data = static_cast<const char*>(mapped);
+    }
+    // The mapping holds the file.
+    close(fd);
+}
+
+IndexReader::Mapping::~Mapping() {
+    if (data != nullptr) {
+        munmap(const_cast<char*>(data), size);
+    }
+}
+
+[[nodiscard]] std::vector<std::string> IndexReader::ReadStrings() {
+    const auto ends = ReadArray<std::uint64_t>();
+    const auto chars = ReadArray<char>();
+    std::vector<std::string> strings;
+    strings.reserve(ends.size());
+    std::uint64_t begin = 0;
+    for (const auto end : ends) {
+        if (end < begin || end > chars.size()) {
+            ThrowTruncated();
+        }
+        strings.emplace_back(chars.data() + begin, end - begin);
+        begin = end;
+    }
+    return strings;
+}
+
+[[nodiscard]] const char* IndexReader::ReadBytes(std::size_t size) {
+    if (size > mapping_.size - position_) {
+        ThrowTruncated();
+    }
+    const char* bytes = mapping_.data + position_;
+    position_ += size;
+    return bytes;
+}
+
+void IndexReader::Align() {
+    const std::size_t padding = (ALIGNMENT - position_ % ALIGNMENT) % ALIGNMENT;
+    (void) ReadBytes(padding);
+}
+
+void IndexReader::ThrowTruncated() {
+    throw std::invalid_argument("Index file is truncated or corrupted"s);
+}
+
+} // namespace index_file
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/// Binary index file of SearchServer.
+///
+/// The file is a header followed by a sequence of values and arrays of trivially copyable types
+/// in the byte order of the machine that wrote it. Every array is its element count followed
+/// by the elements aligned to `ALIGNMENT` bytes from the beginning of the file. The file has
+/// no pointers and no absolute offsets, so it can be mapped at any address and arrays are
+/// copied from the mapped pages as a whole, without parsing elements one by one.
+namespace index_file {
+
+inline constexpr std::uint32_t VERSION = 3;
+inline constexpr std::size_t ALIGNMENT = 8;
+
+/// Writes an index file; throws `std::runtime_error` if the file can't be written.
+///
+/// The data are written to `path + ".tmp"`, and `Finish` renames it over `path` once it is durable,
+/// so a crash at any moment leaves either the whole old file or the whole new one at `path`.
+class IndexWriter {
+public:
+    explicit IndexWriter(const std::string& path);
+
+    IndexWriter(const IndexWriter&) = delete;
+    IndexWriter& operator=(const IndexWriter&) = delete;
+
+    /// Removes the temporary file unless `Finish` succeeded.
+    ~IndexWriter();
+
+    template<typename T>
+    void WriteValue(const T& value) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        WriteBytes(&value, sizeof(T));
+    }
+
+    template<typename T>
+    void WriteArray(const T* values, std::size_t count) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        WriteValue(static_cast<std::uint64_t>(count));
+        Align();
+        WriteBytes(values, count * sizeof(T));
+    }
+
+    template<typename T>
+    void WriteArray(const std::vector<T>& values) {
+        WriteArray(values.data(), values.size());
+    }
+
+    /// Writes the strings as one array of their characters and one array of their end offsets.
+    template<typename StringContainer>
+    void WriteStrings(const StringContainer& strings) {
+        std::vector<std::uint64_t> ends;
+        std::string chars;
+        for (const std::string_view string : strings) {
+            chars += string;
+            ends.push_back(chars.size());
+        }
+        WriteArray(ends);
+        WriteArray(chars.data(), chars.size());
+    }
+
+    /// Flushes and syncs the temporary file, renames it over the target file and syncs the directory;
+    /// throws `std::runtime_error` if some data weren't written.
+    void Finish();
+
+private:
+    std::string path_;
+    std::string temp_path_;
+    std::ofstream output_;
+    bool is_finished_ = false;
+    std::uint64_t size_ = 0;
+
+    void WriteBytes(const void* data, std::size_t size);
+
+    void Align();
+};
+
+/// Maps an index file into memory for reading. Throws `std::runtime_error` if the file can't be mapped
+/// and `std::invalid_argument` if it isn't an index file of the supported version or is truncated.
+class IndexReader {
+public:
+    explicit IndexReader(const std::string& path);
+
+    template<typename T>
+    [[nodiscard]] T ReadValue() {
+        static_assert(std::is_trivially_copyable_v<T>);
+        T value;
+        std::memcpy(&value, ReadBytes(sizeof(T)), sizeof(T));
+        return value;
+    }
+
+    template<typename T>
+    [[nodiscard]] std::vector<T> ReadArray() {
+        static_assert(std::is_trivially_copyable_v<T>);
+        const auto count = ReadValue<std::uint64_t>();
+        Align();
+        if (count > (mapping_.size - position_) / sizeof(T)) {
+            ThrowTruncated();
+        }
+        std::vector<T> values(count);
+        if (count > 0) {
+            std::memcpy(values.data(), ReadBytes(count * sizeof(T)), count * sizeof(T));
+        }
+        return values;
+    }
+
+    /// Reads the strings written by `IndexWriter::WriteStrings`.
+    [[nodiscard]] std::vector<std::string> ReadStrings();
+
+private:
+    // Read-only mapping of a whole file, unmapped on destruction.
+    struct Mapping {
+        const char* data = nullptr;
+        std::size_t size = 0;
+
+        explicit Mapping(const std::string& path);
+
+        Mapping(const Mapping&) = delete;
+        Mapping& operator=(const Mapping&) = delete;
+
+        ~Mapping();
+    };
+
+    Mapping mapping_;
+    std::size_t position_ = 0;
+
+    [[nodiscard]] const char* ReadBytes(std::size_t size);
+
+    void Align();
+
+    [[noreturn]] static void ThrowTruncated();
+};
+
+} // namespace index_file
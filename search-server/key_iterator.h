@@ -0,0 +1,63 @@
+#pragma once
+
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
+/// Adapts an iterator of an associative container to iterate over its keys only.
+template<typename MapIterator>
+class KeyIterator {
+public:
+    using iterator_category = typename std::iterator_traits<MapIterator>::iterator_category;
+    using value_type = std::remove_const_t<typename std::iterator_traits<MapIterator>::value_type::first_type>;
+    using difference_type = typename std::iterator_traits<MapIterator>::difference_type;
+    using pointer = const value_type*;
+    using reference = const value_type&;
+
+    KeyIterator() = default;
+
+    explicit KeyIterator(MapIterator iter) noexcept(std::is_nothrow_move_constructible_v<MapIterator>)
+            : iter_(std::move(iter)) {
+    }
+
+    reference operator*() const noexcept(noexcept(std::declval<MapIterator>()->first)) {
+        return iter_->first;
+    }
+
+    pointer operator->() const noexcept(noexcept(&**this)) {
+        return &**this;
+    }
+
+    bool operator==(const KeyIterator& rhs) const noexcept(noexcept(iter_ == rhs.iter_)) {
+        return iter_ == rhs.iter_;
+    }
+
+    bool operator!=(const KeyIterator& rhs) const noexcept(noexcept(!(*this == rhs))) {
+        return !(*this == rhs);
+    }
+
+    KeyIterator& operator++() noexcept(noexcept(++iter_)) {
+        ++iter_;
+        return *this;
+    }
+
+    KeyIterator operator++(int) noexcept(std::is_nothrow_copy_constructible_v<MapIterator> && noexcept(++iter_)) {
+        auto this_copy = *this;
+        ++iter_;
+        return this_copy;
+    }
+
+    KeyIterator& operator--() noexcept(noexcept(--iter_)) {
+        --iter_;
+        return *this;
+    }
+
+    KeyIterator operator--(int) noexcept(std::is_nothrow_copy_constructible_v<MapIterator> && noexcept(--iter_)) {
+        auto this_copy = *this;
+        --iter_;
+        return this_copy;
+    }
+
+private:
+    MapIterator iter_;
+};
\ No newline at end of file
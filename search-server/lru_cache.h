@@ -0,0 +1,122 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <cstddef>
+
+struct CacheStatistics {
+    std::size_t hit_count = 0;
+    std::size_t miss_count = 0;
+};
+
+/// Bounded cache evicting the least recently used entries, safe to use from several threads.
+///
+/// Keys are spread over shards by their hash, every shard has its own lock and its own LRU list
+/// of `capacity / shard_count` entries (rounded up), so concurrent lookups of different keys rarely wait.
+/// A copy of the cache has the same capacity and shards, but no entries and no statistics.
+template<typename Key, typename Value, typename Hash = std::hash<Key>>
+class ShardedLruCache {
+public:
+    ShardedLruCache(std::size_t capacity, std::size_t shard_count)
+            : shard_capacity_(shard_count > 0 ? (capacity + shard_count - 1) / shard_count : 0) {
+        shards_.reserve(shard_count);
+        for (std::size_t i = 0; i < shard_count; ++i) {
+            shards_.push_back(std::make_unique<Shard>());
+        }
+    }
+
+    ShardedLruCache(const ShardedLruCache& other)
+            : ShardedLruCache(other.shard_capacity_ * other.shards_.size(), other.shards_.size()) {
+    }
+
+    ShardedLruCache& operator=(const ShardedLruCache& other) {
+        if (this != &other) {
+            ShardedLruCache copy(other);
+            shard_capacity_ = copy.shard_capacity_;
+            shards_ = std::move(copy.shards_);
+            hit_count_ = 0;
+            miss_count_ = 0;
+        }
+        return *this;
+    }
+
+    // Lookup
+
+    /// Returns a copy of the value and marks the entry as the most recently used.
+    [[nodiscard]] std::optional<Value> Find(const Key& key) {
+        if (shards_.empty()) {
+            ++miss_count_;
+            return std::nullopt;
+        }
+        auto& shard = GetShard(key);
+        std::lock_guard guard(shard.mutex);
+        const auto iter = shard.positions.find(key);
+        if (iter == shard.positions.end()) {
+            ++miss_count_;
+            return std::nullopt;
+        }
+        shard.entries.splice(shard.entries.begin(), shard.entries, iter->second);
+        ++hit_count_;
+        return iter->second->second;
+    }
+
+    [[nodiscard]] CacheStatistics GetStatistics() const noexcept {
+        return {hit_count_.load(), miss_count_.load()};
+    }
+
+    // Modification
+
+    /// Inserts or replaces the entry, evicting the least recently used entry of a full shard.
+    void Insert(Key key, Value value) {
+        if (shard_capacity_ == 0) {
+            return;
+        }
+        auto& shard = GetShard(key);
+        std::lock_guard guard(shard.mutex);
+        if (const auto iter = shard.positions.find(key); iter != shard.positions.end()) {
+            iter->second->second = std::move(value);
+            shard.entries.splice(shard.entries.begin(), shard.entries, iter->second);
+            return;
+        }
+        if (shard.entries.size() == shard_capacity_) {
+            shard.positions.erase(shard.entries.back().first);
+            shard.entries.pop_back();
+        }
+        shard.entries.emplace_front(std::move(key), std::move(value));
+        shard.positions.emplace(shard.entries.front().first, shard.entries.begin());
+    }
+
+    void Clear() {
+        for (auto& shard : shards_) {
+            std::lock_guard guard(shard->mutex);
+            shard->positions.clear();
+            shard->entries.clear();
+        }
+    }
+
+private:
+    using Entries = std::list<std::pair<Key, Value>>;
+
+    struct Shard {
+        std::mutex mutex;
+        // The most recently used entry is the first one.
+        Entries entries;
+        std::unordered_map<Key, typename Entries::iterator, Hash> positions;
+    };
+
+    std::size_t shard_capacity_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::atomic<std::size_t> hit_count_ = 0;
+    std::atomic<std::size_t> miss_count_ = 0;
+
+    Shard& GetShard(const Key& key) {
+        return *shards_[Hash{}(key) % shards_.size()];
+    }
+};
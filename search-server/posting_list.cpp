@@ -0,0 +1,426 @@
+#include "posting_list.h"
+
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+using bit_packing::BLOCK_SIZE;
+
+PostingList::PostingList(PostingListEncoding encoding) noexcept
+        : encoding_(encoding) {
+}
+
+// Capacity
+
+[[nodiscard]] std::size_t PostingList::size() const noexcept {
+    return blocks_.size() * BLOCK_SIZE + document_ids_.size();
+}
+
+[[nodiscard]] bool PostingList::empty() const noexcept {
+    return size() == 0;
+}
+
+// Lookup
+
+[[nodiscard]] PostingListEncoding PostingList::GetEncoding() const noexcept {
+    return encoding_;
+}
+
+[[nodiscard]] double PostingList::GetMaxTermFrequency() const noexcept {
+    return block_max_term_frequencies_.empty()
+           ? 0.0
+           : *std::max_element(block_max_term_frequencies_.begin(), block_max_term_frequencies_.end());
+}
+
+[[nodiscard]] int PostingList::GetLastDocumentId() const noexcept {
+    return GetBlockLastDocumentId(GetBlockCount() - 1);
+}
+
+// Modification
+
+void PostingList::Add(int document_id, TermCount term_count, double term_frequency) {
+    if (document_id > GetLastCompressedDocumentId()) {
+        const std::size_t tail_position = blocks_.size() * BLOCK_SIZE;
+        const auto [position, is_inserted] = AddToPlain(document_id, term_count);
+        UpdateBoundsOnAdd(tail_position + position, is_inserted, term_frequency);
+        if (encoding_ == PostingListEncoding::COMPRESSED && document_ids_.size() == BLOCK_SIZE) {
+            SealBlock();
+        }
+        return;
+    }
+
+    Decompress();
+    const auto [position, is_inserted] = AddToPlain(document_id, term_count);
+    UpdateBoundsOnAdd(position, is_inserted, term_frequency);
+    Compress();
+}
+
+bool PostingList::Erase(int document_id) {
+    if (document_id > GetLastCompressedDocumentId()) {
+        const std::size_t tail_position = blocks_.size() * BLOCK_SIZE;
+        const auto position = EraseFromPlain(document_id);
+        if (position) {
+            UpdateBoundsOnErase(tail_position + *position);
+        }
+        return position.has_value();
+    }
+
+    Decompress();
+    const auto position = EraseFromPlain(document_id);
+    if (position) {
+        UpdateBoundsOnErase(*position);
+    }
+    Compress();
+    return position.has_value();
+}
+
+void PostingList::SetEncoding(PostingListEncoding encoding) {
+    if (encoding_ == encoding) {
+        return;
+    }
+    encoding_ = encoding;
+    if (encoding_ == PostingListEncoding::COMPRESSED) {
+        Compress();
+    } else {
+        Decompress();
+    }
+}
+
+// Serialization
+
+void PostingList::Write(index_file::IndexWriter& writer) const {
+    writer.WriteValue(encoding_);
+    writer.WriteArray(document_ids_);
+    writer.WriteArray(term_counts_);
+    writer.WriteArray(blocks_);
+    writer.WriteArray(packed_);
+    writer.WriteArray(block_max_term_frequencies_);
+}
+
+[[nodiscard]] PostingList PostingList::Read(index_file::IndexReader& reader) {
+    using namespace std::string_literals;
+
+    PostingList posting_list(reader.ReadValue<PostingListEncoding>());
+    posting_list.document_ids_ = reader.ReadArray<int>();
+    posting_list.term_counts_ = reader.ReadArray<TermCount>();
+    posting_list.blocks_ = reader.ReadArray<Block>();
+    posting_list.packed_ = reader.ReadArray<std::uint32_t>();
+    posting_list.block_max_term_frequencies_ = reader.ReadArray<double>();
+
+    bool is_consistent = (posting_list.encoding_ == PostingListEncoding::PLAIN
+                          || posting_list.encoding_ == PostingListEncoding::COMPRESSED)
+            && (posting_list.encoding_ == PostingListEncoding::COMPRESSED || posting_list.blocks_.empty())
+            && posting_list.document_ids_.size() == posting_list.term_counts_.size()
+            && posting_list.block_max_term_frequencies_.size() == posting_list.GetBlockCount();
+    for (const auto& block : posting_list.blocks_) {
+        is_consistent = is_consistent && block.delta_bit_width <= 32 && block.term_count_bit_width <= 32
+                && block.offset + bit_packing::PackedBlockWordCount(block.delta_bit_width)
+                        + bit_packing::PackedBlockWordCount(block.term_count_bit_width) <= posting_list.packed_.size();
+    }
+    if (!is_consistent) {
+        throw std::invalid_argument("Index file has an inconsistent posting list"s);
+    }
+
+    // Cursors and binary searches rely on the order of postings, so every block is decoded once
+    // to check that its ids go on from the previous block and end with the stored last id.
+    std::int64_t previous_document_id = -1;
+    std::uint32_t document_ids[BLOCK_SIZE];
+    TermCount term_counts[BLOCK_SIZE];
+    for (std::size_t block_index = 0; block_index < posting_list.blocks_.size(); ++block_index) {
+        posting_list.DecodeBlock(block_index, document_ids, term_counts);
+        for (std::size_t i = 0; i < BLOCK_SIZE; ++i) {
+            is_consistent = is_consistent && document_ids[i] > previous_document_id && term_counts[i] > 0;
+            previous_document_id = document_ids[i];
+        }
+        is_consistent = is_consistent
+                && previous_document_id == posting_list.blocks_[block_index].last_document_id;
+    }
+    for (std::size_t i = 0; i < posting_list.document_ids_.size(); ++i) {
+        is_consistent = is_consistent && posting_list.document_ids_[i] > previous_document_id
+                && posting_list.term_counts_[i] > 0;
+        previous_document_id = posting_list.document_ids_[i];
+    }
+    if (!is_consistent) {
+        throw std::invalid_argument("Index file has a posting list out of order"s);
+    }
+    return posting_list;
+}
+
+// Blocks
+
+[[nodiscard]] std::size_t PostingList::GetBlockCount() const noexcept {
+    return (size() + BLOCK_SIZE - 1) / BLOCK_SIZE;
+}
+
+[[nodiscard]] int PostingList::GetBlockLastDocumentId(std::size_t block_index) const noexcept {
+    if (block_index < blocks_.size()) {
+        return blocks_[block_index].last_document_id;
+    }
+    const std::size_t last_position = std::min((block_index + 1) * BLOCK_SIZE, size()) - 1;
+    return document_ids_[last_position - blocks_.size() * BLOCK_SIZE];
+}
+
+void PostingList::UpdateBoundsOnAdd(std::size_t position, bool is_inserted, double term_frequency) {
+    const std::size_t block_index = position / BLOCK_SIZE;
+    if (!is_inserted) {
+        block_max_term_frequencies_[block_index] += term_frequency;
+        return;
+    }
+
+    // Every posting after the inserted one moves one position forward,
+    // so the last posting of a block may move to the next block.
+    block_max_term_frequencies_.resize(GetBlockCount(), 0.0);
+    for (std::size_t i = block_max_term_frequencies_.size() - 1; i > block_index; --i) {
+        block_max_term_frequencies_[i] = std::max(block_max_term_frequencies_[i], block_max_term_frequencies_[i - 1]);
+    }
+    block_max_term_frequencies_[block_index] = std::max(block_max_term_frequencies_[block_index], term_frequency);
+}
+
+void PostingList::UpdateBoundsOnErase(std::size_t position) {
+    // Every posting after the erased one moves one position backward,
+    // so the first posting of a block may move to the previous block.
+    for (std::size_t i = position / BLOCK_SIZE; i + 1 < block_max_term_frequencies_.size(); ++i) {
+        block_max_term_frequencies_[i] = std::max(block_max_term_frequencies_[i], block_max_term_frequencies_[i + 1]);
+    }
+    block_max_term_frequencies_.resize(GetBlockCount());
+}
+
+// Compression
+
+[[nodiscard]] int PostingList::GetLastCompressedDocumentId() const noexcept {
+    return blocks_.empty() ? -1 : blocks_.back().last_document_id;
+}
+
+void PostingList::DecodeBlock(std::size_t block_index,
+                              std::uint32_t* document_ids, TermCount* term_counts) const noexcept {
+    const auto& block = blocks_[block_index];
+    const std::uint32_t* packed_deltas = packed_.data() + block.offset;
+    bit_packing::UnpackBlock(packed_deltas, block.delta_bit_width, document_ids);
+    bit_packing::UnpackBlock(packed_deltas + bit_packing::PackedBlockWordCount(block.delta_bit_width),
+                             block.term_count_bit_width, term_counts);
+
+    auto previous_document_id = static_cast<std::uint32_t>(
+            block_index == 0 ? -1 : blocks_[block_index - 1].last_document_id);
+    for (std::size_t i = 0; i < BLOCK_SIZE; ++i) {
+        previous_document_id += document_ids[i] + 1;
+        document_ids[i] = previous_document_id;
+        term_counts[i] += 1;
+    }
+}
+
+std::pair<std::size_t, bool> PostingList::AddToPlain(int document_id, TermCount term_count) {
+    if (document_ids_.empty() || document_ids_.back() < document_id) {
+        document_ids_.push_back(document_id);
+        term_counts_.push_back(term_count);
+        return {document_ids_.size() - 1, true};
+    }
+
+    auto iter = std::lower_bound(document_ids_.begin(), document_ids_.end(), document_id);
+    const auto pos = std::distance(document_ids_.begin(), iter);
+    if (*iter == document_id) {
+        term_counts_[pos] += term_count;
+        return {static_cast<std::size_t>(pos), false};
+    }
+    document_ids_.insert(iter, document_id);
+    term_counts_.insert(term_counts_.begin() + pos, term_count);
+    return {static_cast<std::size_t>(pos), true};
+}
+
+std::optional<std::size_t> PostingList::EraseFromPlain(int document_id) {
+    auto iter = std::lower_bound(document_ids_.begin(), document_ids_.end(), document_id);
+    if (iter == document_ids_.end() || *iter != document_id) {
+        return std::nullopt;
+    }
+    const auto pos = std::distance(document_ids_.begin(), iter);
+    document_ids_.erase(iter);
+    term_counts_.erase(term_counts_.begin() + pos);
+    return static_cast<std::size_t>(pos);
+}
+
+void PostingList::SealBlock() {
+    std::uint32_t deltas[BLOCK_SIZE];
+    std::uint32_t term_counts[BLOCK_SIZE];
+    int previous_document_id = GetLastCompressedDocumentId();
+    for (std::size_t i = 0; i < BLOCK_SIZE; ++i) {
+        deltas[i] = static_cast<std::uint32_t>(document_ids_[i] - previous_document_id - 1);
+        term_counts[i] = term_counts_[i] - 1;
+        previous_document_id = document_ids_[i];
+    }
+
+    Block block;
+    block.last_document_id = previous_document_id;
+    block.offset = static_cast<std::uint32_t>(packed_.size());
+    block.delta_bit_width = static_cast<std::uint8_t>(bit_packing::RequiredBitWidth(deltas, BLOCK_SIZE));
+    block.term_count_bit_width = static_cast<std::uint8_t>(bit_packing::RequiredBitWidth(term_counts, BLOCK_SIZE));
+
+    const auto delta_word_count = bit_packing::PackedBlockWordCount(block.delta_bit_width);
+    packed_.resize(packed_.size()
+                   + delta_word_count
+                   + bit_packing::PackedBlockWordCount(block.term_count_bit_width));
+    bit_packing::PackBlock(deltas, block.delta_bit_width, packed_.data() + block.offset);
+    bit_packing::PackBlock(term_counts, block.term_count_bit_width,
+                           packed_.data() + block.offset + delta_word_count);
+    blocks_.push_back(block);
+
+    document_ids_.erase(document_ids_.begin(), document_ids_.begin() + BLOCK_SIZE);
+    term_counts_.erase(term_counts_.begin(), term_counts_.begin() + BLOCK_SIZE);
+}
+
+void PostingList::Compress() {
+    std::vector<int> document_ids;
+    std::vector<TermCount> term_counts;
+    document_ids.swap(document_ids_);
+    term_counts.swap(term_counts_);
+
+    const std::size_t full_block_postings = document_ids.size() / BLOCK_SIZE * BLOCK_SIZE;
+    for (std::size_t begin = 0; begin < full_block_postings; begin += BLOCK_SIZE) {
+        document_ids_.assign(document_ids.begin() + begin, document_ids.begin() + begin + BLOCK_SIZE);
+        term_counts_.assign(term_counts.begin() + begin, term_counts.begin() + begin + BLOCK_SIZE);
+        SealBlock();
+    }
+    document_ids_.assign(document_ids.begin() + full_block_postings, document_ids.end());
+    term_counts_.assign(term_counts.begin() + full_block_postings, term_counts.end());
+}
+
+void PostingList::Decompress() {
+    if (blocks_.empty()) {
+        return;
+    }
+
+    std::vector<int> document_ids;
+    std::vector<TermCount> term_counts;
+    document_ids.reserve(size());
+    term_counts.reserve(size());
+    ForEach([&document_ids, &term_counts](int document_id, TermCount term_count) {
+        document_ids.push_back(document_id);
+        term_counts.push_back(term_count);
+    });
+
+    document_ids_.swap(document_ids);
+    term_counts_.swap(term_counts);
+    blocks_.clear();
+    packed_.clear();
+}
+
+// Cursor
+
+PostingList::Cursor::Cursor(const PostingList& posting_list)
+        : posting_list_(&posting_list) {
+    Load();
+}
+
+// Lookup
+
+[[nodiscard]] bool PostingList::Cursor::IsEnd() const noexcept {
+    return document_id_ == END_DOCUMENT_ID;
+}
+
+[[nodiscard]] int PostingList::Cursor::GetDocumentId() const noexcept {
+    return document_id_;
+}
+
+[[nodiscard]] PostingList::TermCount PostingList::Cursor::GetTermCount() const noexcept {
+    return term_count_;
+}
+
+[[nodiscard]] int PostingList::Cursor::GetBlockLastDocumentId(int document_id) const noexcept {
+    const std::size_t block_index = FindBlock(document_id);
+    return block_index == posting_list_->GetBlockCount()
+           ? END_DOCUMENT_ID
+           : posting_list_->GetBlockLastDocumentId(block_index);
+}
+
+[[nodiscard]] double PostingList::Cursor::GetBlockMaxTermFrequency(int document_id) const noexcept {
+    const std::size_t block_index = FindBlock(document_id);
+    return block_index == posting_list_->GetBlockCount()
+           ? 0.0
+           : posting_list_->block_max_term_frequencies_[block_index];
+}
+
+// Movement
+
+void PostingList::Cursor::Next() {
+    ++position_;
+    Load();
+}
+
+void PostingList::Cursor::SkipTo(int document_id) {
+    if (document_id_ >= document_id) {
+        return;
+    }
+
+    const auto& posting_list = *posting_list_;
+    const std::size_t block_index = FindBlock(document_id);
+    if (block_index == posting_list.GetBlockCount()) {
+        position_ = posting_list.size();
+        Load();
+        return;
+    }
+
+    const std::size_t begin = std::max(position_, block_index * BLOCK_SIZE);
+    if (block_index < posting_list.blocks_.size()) {
+        if (decoded_block_index_ != block_index) {
+            posting_list.DecodeBlock(block_index, document_ids_, term_counts_);
+            decoded_block_index_ = block_index;
+        }
+        const auto iter = std::lower_bound(document_ids_ + begin % BLOCK_SIZE, document_ids_ + BLOCK_SIZE,
+                                           static_cast<std::uint32_t>(document_id));
+        position_ = block_index * BLOCK_SIZE + static_cast<std::size_t>(iter - document_ids_);
+    } else {
+        const std::size_t tail_position = posting_list.blocks_.size() * BLOCK_SIZE;
+        const std::size_t end = std::min((block_index + 1) * BLOCK_SIZE, posting_list.size());
+        const auto tail_begin = posting_list.document_ids_.begin();
+        const auto iter = std::lower_bound(tail_begin + (begin - tail_position), tail_begin + (end - tail_position),
+                                           document_id);
+        position_ = tail_position + static_cast<std::size_t>(iter - tail_begin);
+    }
+    Load();
+}
+
+[[nodiscard]] std::size_t PostingList::Cursor::FindBlock(int document_id) const noexcept {
+    const auto& posting_list = *posting_list_;
+    const std::size_t block_count = posting_list.GetBlockCount();
+    std::size_t first = position_ / BLOCK_SIZE;
+    if (first >= block_count || posting_list.GetBlockLastDocumentId(first) >= document_id) {
+        return first;
+    }
+
+    // Binary search for the first block whose last document id is not less than `document_id`.
+    std::size_t count = block_count - first - 1;
+    ++first;
+    while (count > 0) {
+        const std::size_t step = count / 2;
+        if (posting_list.GetBlockLastDocumentId(first + step) < document_id) {
+            first += step + 1;
+            count -= step + 1;
+        } else {
+            count = step;
+        }
+    }
+    return first;
+}
+
+void PostingList::Cursor::Load() {
+    const auto& posting_list = *posting_list_;
+    if (position_ >= posting_list.size()) {
+        position_ = posting_list.size();
+        document_id_ = END_DOCUMENT_ID;
+        term_count_ = 0;
+        return;
+    }
+
+    const std::size_t tail_position = posting_list.blocks_.size() * BLOCK_SIZE;
+    if (position_ < tail_position) {
+        const std::size_t block_index = position_ / BLOCK_SIZE;
+        if (decoded_block_index_ != block_index) {
+            posting_list.DecodeBlock(block_index, document_ids_, term_counts_);
+            decoded_block_index_ = block_index;
+        }
+        document_id_ = static_cast<int>(document_ids_[position_ % BLOCK_SIZE]);
+        term_count_ = term_counts_[position_ % BLOCK_SIZE];
+    } else {
+        document_id_ = posting_list.document_ids_[position_ - tail_position];
+        term_count_ = posting_list.term_counts_[position_ - tail_position];
+    }
+}
@@ -0,0 +1,254 @@
+#pragma once
+
+#include "bit_packing.h"
+#include "index_file.h"
+
+#include <algorithm>
+#include <limits>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+enum class PostingListEncoding {
+    PLAIN,
+    COMPRESSED,
+};
+
+/// Posting list of a single word: the documents containing the word and
+/// the number of occurrences of the word in these documents.
+///
+/// Postings are kept sorted by document id in two parallel contiguous arrays
+/// (structure of arrays), so the scoring loop walks memory sequentially
+/// instead of chasing the nodes of a tree.
+///
+/// The compressed encoding stores full blocks of `bit_packing::BLOCK_SIZE` postings
+/// as bit-packed deltas of document ids and bit-packed term counts. Postings that
+/// don't fill a block yet stay in the plain tail, so appending documents in ascending
+/// id order remains cheap; other modifications of the compressed blocks re-encode the list.
+///
+/// For dynamic pruning every block of `bit_packing::BLOCK_SIZE` consecutive postings, whatever
+/// the encoding is, keeps an upper bound of term frequencies of its postings.
+class PostingList {
+public:
+    using TermCount = std::uint32_t;
+
+    class Cursor;
+
+    explicit PostingList(PostingListEncoding encoding = PostingListEncoding::PLAIN) noexcept;
+
+    // Capacity
+
+    [[nodiscard]] std::size_t size() const noexcept;
+
+    [[nodiscard]] bool empty() const noexcept;
+
+    // Lookup
+
+    [[nodiscard]] PostingListEncoding GetEncoding() const noexcept;
+
+    /// Calls `func(document_id, term_count)` for every posting in ascending order of document ids.
+    /// Compressed blocks are decoded one by one into a small buffer right before they are visited.
+    template<typename Func>
+    void ForEach(Func func) const;
+
+    /// Returns an upper bound of term frequencies of all postings.
+    [[nodiscard]] double GetMaxTermFrequency() const noexcept;
+
+    /// Returns the greatest document id of the postings; the posting list must not be empty.
+    [[nodiscard]] int GetLastDocumentId() const noexcept;
+
+    // Modification
+
+    /// Adds `term_count` to the posting of the document or inserts a new posting.
+    /// `term_frequency` is what the added occurrences contribute to the term frequency
+    /// in the document; it only maintains the upper bounds of blocks.
+    /// Appending documents in ascending id order costs amortized O(1).
+    void Add(int document_id, TermCount term_count, double term_frequency);
+
+    /// Returns true if the posting of the document was found and erased.
+    bool Erase(int document_id);
+
+    /// Erases the postings of all documents for which `is_erased(document_id)` is true at once
+    /// and rebuilds the block bounds from `term_frequency(document_id, term_count)` of the remaining
+    /// postings, so the bounds become tight again. Returns the number of erased postings.
+    template<typename IsErased, typename TermFrequency>
+    std::size_t EraseIf(IsErased is_erased, TermFrequency term_frequency);
+
+    /// Replaces every document id with `new_document_id(document_id)`. New ids must keep the order
+    /// of the postings, so the block bounds stay valid.
+    template<typename NewDocumentId>
+    void RenumberDocuments(NewDocumentId new_document_id);
+
+    void SetEncoding(PostingListEncoding encoding);
+
+    // Serialization
+
+    void Write(index_file::IndexWriter& writer) const;
+
+    /// Throws `std::invalid_argument` if the read arrays are inconsistent, including document ids
+    /// that are negative or aren't strictly increasing across the compressed blocks and the tail.
+    [[nodiscard]] static PostingList Read(index_file::IndexReader& reader);
+
+private:
+    struct Block {
+        int last_document_id;
+        // Position of the packed deltas in `packed_`; the packed term counts follow them.
+        std::uint32_t offset;
+        // Deltas of document ids are stored decremented by one, term counts are stored decremented by one.
+        std::uint8_t delta_bit_width;
+        std::uint8_t term_count_bit_width;
+        // Blocks are written to index files as raw bytes, so the padding is explicit and zeroed.
+        std::uint16_t padding = 0;
+    };
+    static_assert(std::has_unique_object_representations_v<Block>);
+
+    PostingListEncoding encoding_;
+    // All postings of the plain encoding or the tail of the compressed encoding.
+    std::vector<int> document_ids_;
+    std::vector<TermCount> term_counts_;
+    std::vector<Block> blocks_;
+    std::vector<std::uint32_t> packed_;
+    // Indexed by posting position divided by `bit_packing::BLOCK_SIZE`.
+    // Bounds are kept valid but not tight: when postings shift across block boundaries
+    // on insertion or erasure, the bounds of the neighbouring blocks are merged.
+    std::vector<double> block_max_term_frequencies_;
+
+    [[nodiscard]] std::size_t GetBlockCount() const noexcept;
+
+    [[nodiscard]] int GetBlockLastDocumentId(std::size_t block_index) const noexcept;
+
+    [[nodiscard]] int GetLastCompressedDocumentId() const noexcept;
+
+    void DecodeBlock(std::size_t block_index, std::uint32_t* document_ids, TermCount* term_counts) const noexcept;
+
+    /// Returns the position of the posting in the plain postings and whether it is a new one.
+    std::pair<std::size_t, bool> AddToPlain(int document_id, TermCount term_count);
+
+    /// Returns the position the erased posting had in the plain postings.
+    std::optional<std::size_t> EraseFromPlain(int document_id);
+
+    void UpdateBoundsOnAdd(std::size_t position, bool is_inserted, double term_frequency);
+
+    void UpdateBoundsOnErase(std::size_t position);
+
+    void SealBlock();
+
+    void Compress();
+
+    void Decompress();
+};
+
+/// Forward-only cursor over postings for document-at-a-time traversal.
+/// A compressed block is decoded into the cursor's buffer when the cursor enters it,
+/// and whole blocks are skipped by their last document ids without decoding.
+/// The cursor is invalidated by any modification of the posting list.
+class PostingList::Cursor {
+public:
+    /// Document id reported by a cursor that passed the last posting.
+    inline static constexpr int END_DOCUMENT_ID = std::numeric_limits<int>::max();
+
+    explicit Cursor(const PostingList& posting_list);
+
+    // Lookup
+
+    [[nodiscard]] bool IsEnd() const noexcept;
+
+    [[nodiscard]] int GetDocumentId() const noexcept;
+
+    [[nodiscard]] TermCount GetTermCount() const noexcept;
+
+    // Block bounds of the first posting with id not less than `document_id`, the cursor is not moved.
+    // `document_id` must not be less than the current document id.
+
+    [[nodiscard]] int GetBlockLastDocumentId(int document_id) const noexcept;
+
+    [[nodiscard]] double GetBlockMaxTermFrequency(int document_id) const noexcept;
+
+    // Movement
+
+    void Next();
+
+    /// Moves to the first posting with id not less than `document_id`.
+    void SkipTo(int document_id);
+
+private:
+    const PostingList* posting_list_;
+    std::size_t position_ = 0;
+    int document_id_ = END_DOCUMENT_ID;
+    TermCount term_count_ = 0;
+    std::size_t decoded_block_index_ = std::numeric_limits<std::size_t>::max();
+    std::uint32_t document_ids_[bit_packing::BLOCK_SIZE];
+    TermCount term_counts_[bit_packing::BLOCK_SIZE];
+
+    [[nodiscard]] std::size_t FindBlock(int document_id) const noexcept;
+
+    void Load();
+};
+
+// PostingList template implementation
+
+template<typename Func>
+void PostingList::ForEach(Func func) const {
+    if (!blocks_.empty()) {
+        std::uint32_t document_ids[bit_packing::BLOCK_SIZE];
+        TermCount term_counts[bit_packing::BLOCK_SIZE];
+        for (std::size_t block_index = 0; block_index < blocks_.size(); ++block_index) {
+            DecodeBlock(block_index, document_ids, term_counts);
+            for (std::size_t i = 0; i < bit_packing::BLOCK_SIZE; ++i) {
+                func(static_cast<int>(document_ids[i]), term_counts[i]);
+            }
+        }
+    }
+    for (std::size_t i = 0; i < document_ids_.size(); ++i) {
+        func(document_ids_[i], term_counts_[i]);
+    }
+}
+
+template<typename IsErased, typename TermFrequency>
+std::size_t PostingList::EraseIf(IsErased is_erased, TermFrequency term_frequency) {
+    std::vector<int> document_ids;
+    std::vector<TermCount> term_counts;
+    document_ids.reserve(size());
+    term_counts.reserve(size());
+    ForEach([&is_erased, &document_ids, &term_counts](int document_id, TermCount term_count) {
+        if (!is_erased(document_id)) {
+            document_ids.push_back(document_id);
+            term_counts.push_back(term_count);
+        }
+    });
+    const std::size_t erased_count = size() - document_ids.size();
+    if (erased_count == 0) {
+        return 0;
+    }
+
+    document_ids_.swap(document_ids);
+    term_counts_.swap(term_counts);
+    blocks_.clear();
+    packed_.clear();
+    block_max_term_frequencies_.assign(GetBlockCount(), 0.0);
+    for (std::size_t i = 0; i < document_ids_.size(); ++i) {
+        auto& bound = block_max_term_frequencies_[i / bit_packing::BLOCK_SIZE];
+        bound = std::max(bound, static_cast<double>(term_frequency(document_ids_[i], term_counts_[i])));
+    }
+    if (encoding_ == PostingListEncoding::COMPRESSED) {
+        Compress();
+    }
+    return erased_count;
+}
+
+template<typename NewDocumentId>
+void PostingList::RenumberDocuments(NewDocumentId new_document_id) {
+    // Deltas of the compressed blocks change along with the ids.
+    Decompress();
+    for (auto& document_id : document_ids_) {
+        document_id = new_document_id(document_id);
+    }
+    if (encoding_ == PostingListEncoding::COMPRESSED) {
+        Compress();
+    }
+}
+
+// The end of PostingList template implementation
\ No newline at end of file
@@ -16,7 +16,28 @@ std::vector<std::vector<Document>> ProcessQueries(
     return results;
 }
 
+std::vector<std::vector<Document>> ProcessQueries(
+        const search_execution::ThreadPoolPolicy& pool_policy,
+        const SearchServer& search_server,
+        const std::vector<std::string>& queries) {
+    std::vector<std::vector<Document>> results(queries.size());
+    search_execution::ParallelFor(
+            pool_policy, queries.size(),
+            [&search_server, &queries, &results](const std::size_t index) {
+                results[index] = search_server.FindTopDocuments(queries[index]);
+            });
+    return results;
+}
+
 auto ProcessQueriesJoined(const SearchServer& search_server, const std::vector<std::string>& queries)
         -> decltype(MakeFlattenContainer(ProcessQueries(search_server, queries))) {
     return MakeFlattenContainer(ProcessQueries(search_server, queries));
-}
\ No newline at end of file
+}
+
+auto ProcessQueriesJoined(
+        const search_execution::ThreadPoolPolicy& pool_policy,
+        const SearchServer& search_server,
+        const std::vector<std::string>& queries)
+        -> decltype(MakeFlattenContainer(ProcessQueries(pool_policy, search_server, queries))) {
+    return MakeFlattenContainer(ProcessQueries(pool_policy, search_server, queries));
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "document.h"
+#include "execution_policy.h"
 #include "flatten_container.h"
 #include "search_server.h"
 
@@ -10,5 +11,16 @@ std::vector<std::vector<Document>> ProcessQueries(
         const SearchServer& search_server,
         const std::vector<std::string>& queries);
 
+std::vector<std::vector<Document>> ProcessQueries(
+        const search_execution::ThreadPoolPolicy& pool_policy,
+        const SearchServer& search_server,
+        const std::vector<std::string>& queries);
+
 auto ProcessQueriesJoined(const SearchServer& search_server, const std::vector<std::string>& queries)
-        -> decltype(MakeFlattenContainer(ProcessQueries(search_server, queries)));
\ No newline at end of file
+        -> decltype(MakeFlattenContainer(ProcessQueries(search_server, queries)));
+
+auto ProcessQueriesJoined(
+        const search_execution::ThreadPoolPolicy& pool_policy,
+        const SearchServer& search_server,
+        const std::vector<std::string>& queries)
+        -> decltype(MakeFlattenContainer(ProcessQueries(pool_policy, search_server, queries)));
@@ -1,30 +1,65 @@
 #include "remove_duplicates.h"
+#include "hash_combine.h"
 
 #include <algorithm>
+#include <execution>
 #include <iostream>
-#include <set>
-#include <string_view>
+#include <unordered_map>
+#include <vector>
 
-void RemoveDuplicates(SearchServer &server) {
+namespace {
+
+template<typename ExecutionPolicy>
+void RemoveDuplicatesWithPolicy(const ExecutionPolicy& policy, SearchServer& server) {
     using namespace std::string_literals;
+    using TermIds = BorrowedRange<const SearchServer::TermId*>;
+
+    std::vector<int> ids(server.begin(), server.end());
+    std::vector<TermIds> documents;
+    documents.reserve(ids.size());
+    for (const int id : ids) {
+        documents.push_back(server.GetTermIds(id));
+    }
+
+    // Term ids of a document are sorted, so equal sets of words have equal hashes.
+    std::vector<std::size_t> hashes(ids.size());
+    search_execution::ParallelFor(policy, ids.size(), [&documents, &hashes](std::size_t index) {
+        std::size_t hash = 0;
+        for (const auto term_id : documents[index]) {
+            HashCombine(hash, term_id);
+        }
+        hashes[index] = hash;
+    });
 
-    std::set<int> ids_to_remove;
-    std::set<std::set<std::string_view>> documents;
-    for (const auto id : server) {
-        std::set<std::string_view> words;
-        const auto& word_frequencies = server.GetWordFrequencies(id);
-        std::transform(word_frequencies.begin(), word_frequencies.end(),
-                       std::inserter(words, words.end()),
-                       [](const auto& key_value) { return key_value.first; });
-        if (documents.count(words) == 0) {
-            documents.insert(words);
+    // Documents are visited in ascending order of ids, so the one with the smallest id is kept.
+    std::vector<int> ids_to_remove;
+    std::unordered_map<std::size_t, std::vector<std::size_t>> kept_documents_by_hash;
+    for (std::size_t index = 0; index < ids.size(); ++index) {
+        auto& kept_documents = kept_documents_by_hash[hashes[index]];
+        const bool is_duplicate = std::any_of(kept_documents.begin(), kept_documents.end(),
+                                              [&documents, index](std::size_t kept_index) {
+            return std::equal(documents[index].begin(), documents[index].end(),
+                              documents[kept_index].begin(), documents[kept_index].end());
+        });
+        if (is_duplicate) {
+            ids_to_remove.push_back(ids[index]);
         } else {
-            ids_to_remove.insert(id);
+            kept_documents.push_back(index);
         }
     }
 
+    server.RemoveDocuments(policy, ids_to_remove);
     for (const auto& id : ids_to_remove) {
-        server.RemoveDocument(id);
         std::cout << "Found duplicate document id "s << id << "\n"s;
     }
-}
\ No newline at end of file
+}
+
+} // namespace
+
+void RemoveDuplicates(SearchServer& server) {
+    RemoveDuplicatesWithPolicy(std::execution::seq, server);
+}
+
+void RemoveDuplicates(const search_execution::ThreadPoolPolicy& pool_policy, SearchServer& server) {
+    RemoveDuplicatesWithPolicy(pool_policy, server);
+}
@@ -1,7 +1,12 @@
 #pragma once
 
+#include "execution_policy.h"
 #include "search_server.h"
 
 #include <vector>
 
-void RemoveDuplicates(SearchServer& key_value);
\ No newline at end of file
+/// Removes every document having the same set of words as a document with a smaller id.
+void RemoveDuplicates(SearchServer& key_value);
+
+/// The same as above, but word sets are hashed and duplicates are removed by the workers of the pool.
+void RemoveDuplicates(const search_execution::ThreadPoolPolicy& pool_policy, SearchServer& key_value);
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include <cstddef>
+
+/// Relevance accumulator indexed by document ordinal.
+///
+/// Relevances live in a dense array, so accumulating allocates nothing per document;
+/// the list of touched ordinals resets only the entries used by the previous query.
+/// Accumulators are retained by threads and reused across queries, see `Acquire`.
+class ScoreAccumulator {
+public:
+    using key_type = int;
+    using mapped_type = double;
+
+    class Lease;
+
+    /// Returns an empty accumulator retained by the calling thread that can hold ordinals
+    /// less than `document_count`. Nested acquisitions on the same thread, e.g. a search
+    /// called from a predicate, get different accumulators. A retained accumulator much larger
+    /// than `document_count` is shrunk, and a thread retains at most `MAX_RETAINED_COUNT` of them,
+    /// so the memory of the largest index ever searched isn't kept for good.
+    [[nodiscard]] static Lease Acquire(std::size_t document_count);
+
+    inline static constexpr std::size_t MAX_RETAINED_COUNT = 4;
+    // An accumulator holding more than that many times the requested ordinals is shrunk.
+    inline static constexpr std::size_t MAX_SLACK_FACTOR = 4;
+
+    // Capacity
+
+    [[nodiscard]] std::size_t size() const noexcept {
+        return touched_.size();
+    }
+
+    [[nodiscard]] bool empty() const noexcept {
+        return touched_.empty();
+    }
+
+    /// Returns the bound of ordinals the accumulator can hold.
+    [[nodiscard]] std::size_t GetDocumentCapacity() const noexcept {
+        return relevances_.size();
+    }
+
+    // Lookup
+
+    /// Calls `func(ordinal, relevance)` for every touched ordinal in the order they were touched.
+    template<typename Func>
+    void ForEach(Func func) const {
+        for (const key_type ordinal : touched_) {
+            func(ordinal, relevances_[ordinal]);
+        }
+    }
+
+    /// The same as `ForEach`, but in ascending order of ordinals, which costs sorting the touched ordinals.
+    template<typename Func>
+    void ForEachOrdered(Func func) {
+        std::sort(touched_.begin(), touched_.end());
+        ForEach(func);
+    }
+
+    // Modification
+
+    mapped_type& operator[](key_type ordinal) {
+        if (!is_touched_[ordinal]) {
+            is_touched_[ordinal] = true;
+            touched_.push_back(ordinal);
+        }
+        return relevances_[ordinal];
+    }
+
+    void Clear() noexcept {
+        for (const key_type ordinal : touched_) {
+            relevances_[ordinal] = 0.0;
+            is_touched_[ordinal] = false;
+        }
+        touched_.clear();
+    }
+
+private:
+    inline static thread_local std::vector<std::unique_ptr<ScoreAccumulator>> free_accumulators_;
+
+    std::vector<mapped_type> relevances_;
+    std::vector<char> is_touched_;
+    std::vector<key_type> touched_;
+
+    /// The accumulator must be empty.
+    void Fit(std::size_t document_count) {
+        if (relevances_.size() < document_count) {
+            relevances_.resize(document_count, 0.0);
+            is_touched_.resize(document_count, false);
+        } else if (relevances_.size() > MAX_SLACK_FACTOR * document_count) {
+            std::vector<mapped_type>(document_count, 0.0).swap(relevances_);
+            std::vector<char>(document_count, false).swap(is_touched_);
+            touched_.shrink_to_fit();
+        }
+    }
+};
+
+/// Gives the accumulator back to the thread's free list on destruction.
+class ScoreAccumulator::Lease {
+public:
+    explicit Lease(std::unique_ptr<ScoreAccumulator> accumulator) noexcept
+            : accumulator_(std::move(accumulator)) {
+    }
+
+    Lease(const Lease&) = delete;
+    Lease& operator=(const Lease&) = delete;
+
+    ~Lease() {
+        if (free_accumulators_.size() < MAX_RETAINED_COUNT) {
+            accumulator_->Clear();
+            free_accumulators_.push_back(std::move(accumulator_));
+        }
+    }
+
+    ScoreAccumulator& operator*() const noexcept {
+        return *accumulator_;
+    }
+
+    ScoreAccumulator* operator->() const noexcept {
+        return accumulator_.get();
+    }
+
+private:
+    std::unique_ptr<ScoreAccumulator> accumulator_;
+};
+
+inline ScoreAccumulator::Lease ScoreAccumulator::Acquire(std::size_t document_count) {
+    std::unique_ptr<ScoreAccumulator> accumulator;
+    if (free_accumulators_.empty()) {
+        accumulator = std::make_unique<ScoreAccumulator>();
+    } else {
+        accumulator = std::move(free_accumulators_.back());
+        free_accumulators_.pop_back();
+    }
+    accumulator->Fit(document_count);
+    return Lease(std::move(accumulator));
+}
@@ -1,5 +1,8 @@
 #include "search_server.h"
+#include "set_intersection.h"
+#include "hash_combine.h"
 
+#include <atomic>
 #include <numeric>
 #include <stdexcept>
 #include <execution>
@@ -15,26 +18,45 @@ SearchServer::SearchServer(std::string_view stop_words)
 // Capacity and Lookup
 
 [[nodiscard]] int SearchServer::GetDocumentCount() const noexcept {
-    return static_cast<int>(documents_.size());
+    return static_cast<int>(document_id_to_ordinal_.size());
 }
 
-[[nodiscard]] const std::map<std::string_view, double>& SearchServer::GetWordFrequencies(int document_id) const {
-    static const std::map<std::string_view, double> empty_map;
+[[nodiscard]] std::map<std::string_view, double> SearchServer::GetWordFrequencies(int document_id) const {
+    std::map<std::string_view, double> word_frequencies;
+    for (const auto [term_id, term_frequency] : GetTermFrequencies(document_id)) {
+        word_frequencies.emplace(term_dictionary_.GetTerm(term_id), term_frequency);
+    }
+    return word_frequencies;
+}
 
-    if (auto it = documents_.find(document_id); it != documents_.end()) {
-        return it->second.word_frequencies;
+[[nodiscard]] std::map<SearchServer::TermId, double> SearchServer::GetTermFrequencies(int document_id) const {
+    std::map<TermId, double> term_frequencies;
+    if (const auto document_ordinal = FindDocumentOrdinal(document_id)) {
+        const double inverse_word_count = documents_.inverse_word_counts[*document_ordinal];
+        for (std::size_t i = documents_.term_offsets[*document_ordinal];
+             i < documents_.term_offsets[*document_ordinal + 1]; ++i) {
+            term_frequencies.emplace_hint(term_frequencies.end(),
+                                          documents_.term_ids[i], documents_.term_counts[i] * inverse_word_count);
+        }
     }
-    return empty_map;
+    return term_frequencies;
+}
+
+[[nodiscard]] BorrowedRange<const SearchServer::TermId*> SearchServer::GetTermIds(int document_id) const {
+    if (const auto document_ordinal = FindDocumentOrdinal(document_id)) {
+        return GetDocumentTermIds(*document_ordinal);
+    }
+    return {nullptr, nullptr};
 }
 
 // Iterators
 
-[[nodiscard]] std::set<int>::const_iterator SearchServer::begin() const noexcept {
-    return document_ids_.begin();
+[[nodiscard]] SearchServer::DocumentIdIterator SearchServer::begin() const noexcept {
+    return DocumentIdIterator(document_id_to_ordinal_.begin());
 }
 
-[[nodiscard]] std::set<int>::const_iterator SearchServer::end() const noexcept {
-    return document_ids_.end();
+[[nodiscard]] SearchServer::DocumentIdIterator SearchServer::end() const noexcept {
+    return DocumentIdIterator(document_id_to_ordinal_.end());
 }
 
 // Modification
@@ -43,119 +65,403 @@ void SearchServer::AddDocument(int document_id, std::string_view document, Docum
                                const std::vector<int>& ratings) {
     CheckDocumentIdIsNotNegative(document_id);
     CheckDocumentIdDoesntExist(document_id);
+    AddTokenizedDocument(document_id, document, TokenizeDocument(document), status, ratings);
+}
 
-    auto words = SplitIntoWordsNoStop(document);
+void SearchServer::AddDocuments(const std::vector<DocumentToAdd>& documents,
+                                std::size_t checkpoint_document_count) {
+    AddDocuments(std::execution::seq, documents, checkpoint_document_count);
+}
 
-    document_ids_.insert(document_id);
-    auto& document_data = documents_[document_id];
-    document_data.rating = ComputeAverageRating(ratings);
-    document_data.status = status;
+void SearchServer::RemoveDocument(int document_id) {
+    if (const auto document_ordinal = MarkDocumentRemoved(document_id)) {
+        CompactAfterRemoval(std::execution::seq, GetDocumentTermIds(*document_ordinal));
+    }
+}
 
-    const double inv_size = 1.0 / static_cast<double>(words.size());
-    for (auto& word : words) {
-        auto iter = word_to_document_frequencies_.find(word);
-        if (iter == word_to_document_frequencies_.end()) {
-            auto doc_frequency = std::map<int, double>{{document_id, inv_size}};
-            auto [insert_pos, _] = word_to_document_frequencies_.emplace(std::move(word), std::move(doc_frequency));
-            iter = insert_pos;
+void SearchServer::RemoveDocument(const std::execution::sequenced_policy&, int document_id) {
+    RemoveDocument(document_id);
+}
+
+void SearchServer::RemoveDocument(const std::execution::parallel_policy& par_policy, int document_id) {
+    RemoveDocumentInParallel(par_policy, document_id);
+}
+
+void SearchServer::RemoveDocument(const search_execution::ThreadPoolPolicy& pool_policy, int document_id) {
+    RemoveDocumentInParallel(pool_policy, document_id);
+}
+
+template<typename ExecutionPolicy>
+void SearchServer::RemoveDocumentInParallel(const ExecutionPolicy& policy, int document_id) {
+    if (const auto document_ordinal = MarkDocumentRemoved(document_id)) {
+        CompactAfterRemoval(policy, GetDocumentTermIds(*document_ordinal));
+    }
+}
+
+std::optional<SearchServer::DocumentOrdinal> SearchServer::MarkDocumentRemoved(int document_id) {
+    auto ordinal_iter = document_id_to_ordinal_.find(document_id);
+    if (ordinal_iter == document_id_to_ordinal_.end()) {
+        return std::nullopt;
+    }
+
+    LogRemoveDocument(document_id);
+    const auto document_ordinal = ordinal_iter->second;
+    for (const TermId term_id : GetDocumentTermIds(document_ordinal)) {
+        --term_document_counts_[term_id];
+    }
+
+    ClearDocument(document_ordinal);
+    document_id_to_ordinal_.erase(ordinal_iter);
+    return document_ordinal;
+}
+
+void SearchServer::CompactIndex() {
+    CompactIndex(std::execution::seq);
+}
+
+void SearchServer::SetCompactionThresholds(double max_removed_posting_share, double max_removed_document_share) {
+    if (!(max_removed_posting_share >= 0.0) || !(max_removed_document_share >= 0.0)) {
+        throw std::invalid_argument("Compaction thresholds must not be negative"s);
+    }
+    max_removed_posting_share_ = max_removed_posting_share;
+    max_removed_document_share_ = max_removed_document_share;
+}
+
+void SearchServer::SetPostingListEncoding(PostingListEncoding encoding) {
+    posting_list_encoding_ = encoding;
+    for (auto& posting_list : term_to_document_frequencies_) {
+        posting_list.SetEncoding(encoding);
+    }
+}
+
+[[nodiscard]] SearchServer::TokenizedDocument SearchServer::TokenizeDocument(std::string_view document) const {
+    TokenizedDocument tokenized_document;
+    const WordRange words(document);
+    for (const auto word : words) {
+        if (IsStopWord(word)) {
+            continue;
+        }
+        if (const auto term_id = term_dictionary_.Find(word)) {
+            tokenized_document.term_ids.push_back(*term_id);
         } else {
-            auto& doc_frequency = iter->second;
-            doc_frequency[document_id] += inv_size;
+            tokenized_document.new_words.push_back(word);
         }
-        const std::string_view word_view = iter->first;
-        document_data.word_frequencies[word_view] += inv_size;
     }
+    tokenized_document.has_forbidden_chars = words.HasControlChars();
+    return tokenized_document;
 }
 
-void SearchServer::RemoveDocument(int document_id) {
-    if (auto doc_iter = documents_.find(document_id); doc_iter != documents_.end()) {
-        const auto& document_data = doc_iter->second;
-        for (const auto& [word, _] : document_data.word_frequencies) {
-            auto word_iter = word_to_document_frequencies_.find(word);
-            auto& documents_with_that_word = word_iter->second;
-            documents_with_that_word.erase(document_id);
-
-            if (documents_with_that_word.empty()) {
-                word_to_document_frequencies_.erase(word_iter);
-            }
-        }
+void SearchServer::AddTokenizedDocument(int document_id, std::string_view document,
+                                        TokenizedDocument tokenized_document, DocumentStatus status,
+                                        const std::vector<int>& ratings) {
+    AddPostings(AppendDocument(document_id, document, std::move(tokenized_document), status, ratings));
+}
+
+SearchServer::DocumentOrdinal SearchServer::AppendDocument(int document_id, std::string_view document,
+                                                           TokenizedDocument tokenized_document,
+                                                           DocumentStatus status, const std::vector<int>& ratings) {
+    CheckDocumentIdIsNotNegative(document_id);
+    CheckDocumentIdDoesntExist(document_id);
+    CheckNoForbiddenCharsFound(tokenized_document.has_forbidden_chars);
+    if (write_ahead_log_.log != nullptr) {
+        write_ahead_log_.log->AppendAddDocument(log_sequence_number_ + 1, document_id, document, status, ratings);
+        ++log_sequence_number_;
+    }
+
+    generation_ = NextGeneration();
+    const auto document_ordinal = static_cast<DocumentOrdinal>(documents_.ids.size());
+    document_id_to_ordinal_.emplace(document_id, document_ordinal);
+    documents_.ids.push_back(document_id);
+    documents_.ratings.push_back(ComputeAverageRating(ratings));
+    documents_.statuses.push_back(status);
+    documents_.status_bitmaps[static_cast<std::size_t>(status)].Set(static_cast<std::size_t>(document_ordinal));
+
+    // Only words missing from the dictionary are copied, after the whole document is checked.
+    auto& term_ids = tokenized_document.term_ids;
+    for (const auto word : tokenized_document.new_words) {
+        term_ids.push_back(term_dictionary_.Intern(word));
+    }
+    if (term_to_document_frequencies_.size() < term_dictionary_.GetIdBound()) {
+        term_to_document_frequencies_.resize(term_dictionary_.GetIdBound(), PostingList(posting_list_encoding_));
+        term_document_counts_.resize(term_dictionary_.GetIdBound(), 0);
+    }
 
-        documents_.erase(doc_iter);
-        document_ids_.erase(document_id);
+    // Equal term ids are adjacent after sorting, so a term count is the length of its run.
+    std::sort(term_ids.begin(), term_ids.end());
+    documents_.inverse_word_counts.push_back(1.0 / static_cast<double>(term_ids.size()));
+    for (auto iter = term_ids.begin(); iter != term_ids.end();) {
+        const TermId term_id = *iter;
+        const auto run_end = std::find_if(iter, term_ids.end(), [term_id](const TermId other_id) {
+            return other_id != term_id;
+        });
+        ++term_document_counts_[term_id];
+        documents_.term_ids.push_back(term_id);
+        documents_.term_counts.push_back(static_cast<PostingList::TermCount>(run_end - iter));
+        iter = run_end;
     }
+    documents_.term_offsets.push_back(documents_.term_ids.size());
+    return document_ordinal;
 }
 
-void SearchServer::RemoveDocument(const std::execution::sequenced_policy&, int document_id) {
-    RemoveDocument(document_id);
+void SearchServer::AddPostings(DocumentOrdinal document_ordinal) {
+    const double inverse_word_count = documents_.inverse_word_counts[document_ordinal];
+    for (std::size_t i = documents_.term_offsets[document_ordinal]; i < documents_.term_offsets[document_ordinal + 1];
+         ++i) {
+        const auto term_count = documents_.term_counts[i];
+        term_to_document_frequencies_[documents_.term_ids[i]].Add(document_ordinal, term_count,
+                                                                  term_count * inverse_word_count);
+    }
 }
 
-void SearchServer::RemoveDocument(const std::execution::parallel_policy&, int document_id) {
-    auto document_iter = documents_.find(document_id);
-    if (document_iter == documents_.end()) {
-        return;
+void SearchServer::LogRemoveDocument(int document_id) {
+    if (write_ahead_log_.log != nullptr) {
+        write_ahead_log_.log->AppendRemoveDocument(log_sequence_number_ + 1, document_id);
+        ++log_sequence_number_;
     }
+}
 
-    const auto& document_data = document_iter->second;
+void SearchServer::ClearDocument(DocumentOrdinal document_ordinal) {
+    generation_ = NextGeneration();
+    const auto status = documents_.statuses[document_ordinal];
+    documents_.status_bitmaps[static_cast<std::size_t>(status)].Reset(static_cast<std::size_t>(document_ordinal));
+    documents_.tombstones.Set(static_cast<std::size_t>(document_ordinal));
+}
 
-    std::vector<std::string_view> word_views(document_data.word_frequencies.size());
-    std::transform(
-            document_data.word_frequencies.cbegin(), document_data.word_frequencies.cend(),
-            word_views.begin(),
-            [](const auto& key_value) {
-                return key_value.first;
+void SearchServer::EraseRemovedPostings(TermId term_id) {
+    (void) term_to_document_frequencies_[term_id].EraseIf(
+            [this](DocumentOrdinal document_ordinal) {
+                return documents_.tombstones.Test(static_cast<std::size_t>(document_ordinal));
+            },
+            [this](DocumentOrdinal document_ordinal, PostingList::TermCount term_count) {
+                return term_count * documents_.inverse_word_counts[document_ordinal];
             });
+}
+
+[[nodiscard]] std::vector<SearchServer::DocumentOrdinal> SearchServer::DropRemovedDocuments() {
+    // Ordinals kept by prepared queries become invalid.
+    generation_ = NextGeneration();
+    std::vector<DocumentOrdinal> new_ordinals(documents_.ids.size(), -1);
+    DocumentColumns documents;
+    const std::size_t document_count = document_id_to_ordinal_.size();
+    documents.ids.reserve(document_count);
+    documents.ratings.reserve(document_count);
+    documents.statuses.reserve(document_count);
+    documents.inverse_word_counts.reserve(document_count);
+    documents.term_offsets.reserve(document_count + 1);
+    for (std::size_t ordinal = 0; ordinal < documents_.ids.size(); ++ordinal) {
+        if (documents_.tombstones.Test(ordinal)) {
+            continue;
+        }
+        const auto new_ordinal = static_cast<DocumentOrdinal>(documents.ids.size());
+        new_ordinals[ordinal] = new_ordinal;
+        documents.ids.push_back(documents_.ids[ordinal]);
+        documents.ratings.push_back(documents_.ratings[ordinal]);
+        documents.statuses.push_back(documents_.statuses[ordinal]);
+        documents.inverse_word_counts.push_back(documents_.inverse_word_counts[ordinal]);
+        documents.status_bitmaps[static_cast<std::size_t>(documents_.statuses[ordinal])].Set(
+                static_cast<std::size_t>(new_ordinal));
+        const auto begin = static_cast<std::ptrdiff_t>(documents_.term_offsets[ordinal]);
+        const auto end = static_cast<std::ptrdiff_t>(documents_.term_offsets[ordinal + 1]);
+        documents.term_ids.insert(documents.term_ids.end(),
+                                  documents_.term_ids.begin() + begin, documents_.term_ids.begin() + end);
+        documents.term_counts.insert(documents.term_counts.end(),
+                                     documents_.term_counts.begin() + begin, documents_.term_counts.begin() + end);
+        documents.term_offsets.push_back(documents.term_ids.size());
+    }
+
+    for (auto& [document_id, document_ordinal] : document_id_to_ordinal_) {
+        document_ordinal = new_ordinals[document_ordinal];
+    }
+    documents_ = std::move(documents);
+    return new_ordinals;
+}
+
+void SearchServer::ReleaseTerm(TermId term_id) {
+    term_dictionary_.Release(term_id);
+    term_to_document_frequencies_[term_id] = PostingList(posting_list_encoding_);
+}
+
+[[nodiscard]] std::uint64_t SearchServer::NextGeneration() noexcept {
+    static std::atomic<std::uint64_t> last_generation = 0;
+    return last_generation.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+// Persistence
+
+void SearchServer::SaveIndex(const std::string& path) const {
+    index_file::IndexWriter writer(path);
+    writer.WriteValue(log_sequence_number_);
+    writer.WriteStrings(stop_words_);
+    term_dictionary_.Write(writer);
+    writer.WriteValue(posting_list_encoding_);
+    writer.WriteValue(static_cast<std::uint64_t>(term_to_document_frequencies_.size()));
+    for (const auto& posting_list : term_to_document_frequencies_) {
+        posting_list.Write(writer);
+    }
+    writer.WriteArray(term_document_counts_);
+    writer.WriteArray(documents_.ids);
+    writer.WriteArray(documents_.ratings);
+    writer.WriteArray(documents_.statuses);
+    writer.WriteArray(documents_.inverse_word_counts);
+    writer.WriteArray(documents_.term_offsets);
+    writer.WriteArray(documents_.term_ids);
+    writer.WriteArray(documents_.term_counts);
+    for (const auto& status_bitmap : documents_.status_bitmaps) {
+        status_bitmap.Write(writer);
+    }
+    writer.Finish();
+}
+
+[[nodiscard]] SearchServer SearchServer::LoadIndex(const std::string& path) {
+    index_file::IndexReader reader(path);
+    const auto log_sequence_number = reader.ReadValue<std::uint64_t>();
+    SearchServer server(reader.ReadStrings());
+    server.log_sequence_number_ = log_sequence_number;
+    server.term_dictionary_ = TermDictionary::Read(reader);
+    server.posting_list_encoding_ = reader.ReadValue<PostingListEncoding>();
+    const auto term_id_bound = reader.ReadValue<std::uint64_t>();
+    if (term_id_bound != server.term_dictionary_.GetIdBound()) {
+        throw std::invalid_argument("Index file has posting lists of unknown terms"s);
+    }
+    server.term_to_document_frequencies_.reserve(term_id_bound);
+    for (std::uint64_t term_id = 0; term_id < term_id_bound; ++term_id) {
+        server.term_to_document_frequencies_.push_back(PostingList::Read(reader));
+    }
+    server.term_document_counts_ = reader.ReadArray<std::size_t>();
+    if (server.term_document_counts_.size() != term_id_bound) {
+        throw std::invalid_argument("Index file has inconsistent document frequencies"s);
+    }
+    for (std::uint64_t term_id = 0; term_id < term_id_bound; ++term_id) {
+        if (server.term_document_counts_[term_id] > server.term_to_document_frequencies_[term_id].size()) {
+            throw std::invalid_argument("Index file has inconsistent document frequencies"s);
+        }
+    }
+
+    auto& documents = server.documents_;
+    documents.ids = reader.ReadArray<int>();
+    documents.ratings = reader.ReadArray<int>();
+    documents.statuses = reader.ReadArray<DocumentStatus>();
+    documents.inverse_word_counts = reader.ReadArray<double>();
+    documents.term_offsets = reader.ReadArray<std::size_t>();
+    documents.term_ids = reader.ReadArray<TermId>();
+    documents.term_counts = reader.ReadArray<PostingList::TermCount>();
+    for (auto& status_bitmap : documents.status_bitmaps) {
+        status_bitmap = Bitmap::Read(reader);
+    }
 
-    std::for_each(
-            std::execution::par,
-            word_views.cbegin(), word_views.cend(),
-            [this, document_id](const auto word_view) {
-                auto& documents_with_that_word = word_to_document_frequencies_.find(word_view)->second;
-                documents_with_that_word.erase(document_id);
+    const std::size_t document_count = documents.ids.size();
+    const bool are_columns_consistent = documents.ratings.size() == document_count
+            && documents.statuses.size() == document_count
+            && documents.inverse_word_counts.size() == document_count
+            && documents.term_offsets.size() == document_count + 1
+            && std::is_sorted(documents.term_offsets.begin(), documents.term_offsets.end())
+            && documents.term_offsets.front() == 0
+            && documents.term_offsets.back() == documents.term_ids.size()
+            && documents.term_counts.size() == documents.term_ids.size()
+            && std::all_of(documents.term_ids.begin(), documents.term_ids.end(), [&](const TermId term_id) {
+                return term_id < term_id_bound;
             });
+    if (!are_columns_consistent) {
+        throw std::invalid_argument("Index file has inconsistent document columns"s);
+    }
+    // Postings are sorted, so the last one has the greatest document ordinal.
+    for (const auto& posting_list : server.term_to_document_frequencies_) {
+        if (!posting_list.empty() && static_cast<std::size_t>(posting_list.GetLastDocumentId()) >= document_count) {
+            throw std::invalid_argument("Index file has postings of unknown documents"s);
+        }
+    }
+
+    // Present documents are the ones having their status, others are removed.
+    for (std::size_t ordinal = 0; ordinal < document_count; ++ordinal) {
+        const auto status = static_cast<std::size_t>(documents.statuses[ordinal]);
+        if (status >= DOCUMENT_STATUS_COUNT) {
+            throw std::invalid_argument("Index file has an unknown document status"s);
+        }
+        if (!documents.status_bitmaps[status].Test(ordinal)) {
+            documents.tombstones.Set(ordinal);
+        } else if (!server.document_id_to_ordinal_.emplace(documents.ids[ordinal],
+                                                           static_cast<DocumentOrdinal>(ordinal)).second) {
+            throw std::invalid_argument("Index file has a repeated document id"s);
+        }
+    }
+    return server;
+}
+
+void SearchServer::AttachWriteAheadLog(WriteAheadLog* write_ahead_log) noexcept {
+    write_ahead_log_.log = write_ahead_log;
+}
 
-    documents_.erase(document_iter);
-    document_ids_.erase(document_id);
+void SearchServer::ReplayWriteAheadLog(const std::string& path) {
+    // Replayed changes are already recorded.
+    auto* const write_ahead_log = std::exchange(write_ahead_log_.log, nullptr);
+    try {
+        WriteAheadLog::ForEachRecord(path, [this](const WriteAheadLog::Record& record) {
+            if (record.sequence_number <= log_sequence_number_) {
+                return;
+            }
+            if (record.type == WriteAheadLog::RecordType::ADD_DOCUMENT) {
+                AddDocument(record.document_id, record.text, record.status, record.ratings);
+            } else {
+                RemoveDocument(record.document_id);
+            }
+            log_sequence_number_ = record.sequence_number;
+        });
+    } catch (...) {
+        write_ahead_log_.log = write_ahead_log;
+        throw;
+    }
+    write_ahead_log_.log = write_ahead_log;
 }
 
 // Search
 
-[[nodiscard]] std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query,
-                                                                   DocumentStatus document_status) const {
-    return FindTopDocuments(
-            raw_query,
-            [document_status](int /*document_id*/, DocumentStatus status, int /*rating*/) {
-                return status == document_status;
-            });
+[[nodiscard]] std::vector<Document> SearchServer::FindTopDocuments(
+        std::string_view raw_query, DocumentStatus document_status, std::size_t result_count) const {
+    return FindTopDocuments(std::execution::seq, raw_query, document_status, result_count);
 }
 
 [[nodiscard]] std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query) const {
     return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
 }
 
+[[nodiscard]] SearchServer::PreparedQuery SearchServer::PrepareQuery(std::string_view raw_query) const {
+    PreparedQuery prepared_query;
+    prepared_query.search_server_ = this;
+    prepared_query.generation_ = generation_;
+    const WordRange words(raw_query);
+    for (const auto word : words) {
+        const auto query_word = ParseQueryWord(word);
+        if (query_word.is_stop) {
+            continue;
+        }
+        auto& prepared_words = query_word.is_minus ? prepared_query.minus_words_ : prepared_query.plus_words_;
+        prepared_words.emplace_back(query_word.content);
+    }
+    CheckNoForbiddenCharsFound(words.HasControlChars());
+    for (auto* words : {&prepared_query.plus_words_, &prepared_query.minus_words_}) {
+        std::sort(words->begin(), words->end());
+        words->erase(std::unique(words->begin(), words->end()), words->end());
+    }
+    prepared_query.query_ = ResolveQuery(prepared_query.plus_words_, prepared_query.minus_words_);
+    return prepared_query;
+}
+
+[[nodiscard]] std::vector<Document> SearchServer::FindTopDocuments(
+        const PreparedQuery& prepared_query, DocumentStatus document_status, std::size_t result_count) const {
+    return FindTopDocuments(std::execution::seq, prepared_query, document_status, result_count);
+}
+
+[[nodiscard]] std::vector<Document> SearchServer::FindTopDocuments(const PreparedQuery& prepared_query) const {
+    return FindTopDocuments(prepared_query, DocumentStatus::ACTUAL);
+}
+
 [[nodiscard]] SearchServer::MatchingWordsAndDocStatus SearchServer::MatchDocument(
         std::string_view raw_query, int document_id) const {
     CheckDocumentIdIsNotNegative(document_id);
     CheckDocumentIdExists(document_id);
 
     const auto query = ParseQuery(std::execution::seq, raw_query, WordsRepeatable::No);
-    const auto& document_data = documents_.at(document_id);
-    const auto& word_frequencies_in_that_documents = document_data.word_frequencies;
-
-    std::vector<std::string_view> matched_words;
-    for (const auto minus_word_view : query.minus_words) {
-        auto iter = word_frequencies_in_that_documents.find(minus_word_view);
-        if (iter != word_frequencies_in_that_documents.end()) {
-            return make_tuple(std::move(matched_words), document_data.status);
-        }
-    }
-    for (const auto plus_word_view : query.plus_words) {
-        auto iter = word_frequencies_in_that_documents.find(plus_word_view);
-        if (iter != word_frequencies_in_that_documents.end()) {
-            matched_words.emplace_back(plus_word_view);
-        }
-    }
-
-    return make_tuple(std::move(matched_words), document_data.status);
+    return MatchQuery(std::execution::seq, query, document_id_to_ordinal_.at(document_id));
 }
 
 [[nodiscard]] SearchServer::MatchingWordsAndDocStatus SearchServer::MatchDocument(
@@ -164,56 +470,279 @@ void SearchServer::RemoveDocument(const std::execution::parallel_policy&, int do
 }
 
 [[nodiscard]] SearchServer::MatchingWordsAndDocStatus SearchServer::MatchDocument(
-        const std::execution::parallel_policy&, std::string_view raw_query, int document_id) const {
+        const std::execution::parallel_policy& par_policy, std::string_view raw_query, int document_id) const {
+    return MatchDocumentInParallel(par_policy, raw_query, document_id);
+}
+
+[[nodiscard]] SearchServer::MatchingWordsAndDocStatus SearchServer::MatchDocument(
+        const search_execution::ThreadPoolPolicy& pool_policy, std::string_view raw_query, int document_id) const {
+    return MatchDocumentInParallel(pool_policy, raw_query, document_id);
+}
+
+[[nodiscard]] SearchServer::MatchingWordsAndDocStatus SearchServer::MatchDocument(
+        const search_execution::AdaptivePolicy& adaptive_policy, std::string_view raw_query, int document_id) const {
+    CheckDocumentIdIsNotNegative(document_id);
+    CheckDocumentIdExists(document_id);
+
+    auto query = ParseQuery(std::execution::seq, raw_query, WordsRepeatable::Yes);
+    const auto document_ordinal = document_id_to_ordinal_.at(document_id);
+    const std::size_t term_count = query.plus_terms.size() + query.minus_terms.size();
+    if (term_count >= adaptive_policy.min_parallel_match_term_count
+            && search_execution::GetWorkerCount(adaptive_policy) > 1) {
+        return MatchQuery(search_execution::par_pool, query, document_ordinal);
+    }
+    RemoveDuplicateTerms(std::execution::seq, query.plus_terms);
+    RemoveDuplicateTerms(std::execution::seq, query.minus_terms);
+    return MatchQuery(std::execution::seq, query, document_ordinal);
+}
+
+[[nodiscard]] SearchServer::MatchingWordsAndDocStatus SearchServer::MatchDocument(
+        const PreparedQuery& prepared_query, int document_id) const {
+    CheckDocumentIdIsNotNegative(document_id);
+    CheckDocumentIdExists(document_id);
+
+    Query query_storage;
+    return MatchQuery(std::execution::seq, GetQuery(prepared_query, query_storage),
+                      document_id_to_ordinal_.at(document_id));
+}
+
+[[nodiscard]] search_execution::QueryCost SearchServer::EstimateQueryCost(std::string_view raw_query) const {
+    return EstimateQueryCost(ParseQuery(std::execution::seq, raw_query, WordsRepeatable::No));
+}
+
+template<typename ExecutionPolicy>
+[[nodiscard]] SearchServer::MatchingWordsAndDocStatus SearchServer::MatchDocumentInParallel(
+        const ExecutionPolicy& policy, std::string_view raw_query, int document_id) const {
     CheckDocumentIdIsNotNegative(document_id);
     CheckDocumentIdExists(document_id);
 
     const auto query = ParseQuery(std::execution::seq, raw_query, WordsRepeatable::Yes);
-    const auto& document_data = documents_.at(document_id);
-    const auto& word_frequencies_in_that_documents = document_data.word_frequencies;
+    return MatchQuery(policy, query, document_id_to_ordinal_.at(document_id));
+}
+
+template<typename ExecutionPolicy>
+[[nodiscard]] SearchServer::MatchingWordsAndDocStatus SearchServer::MatchQuery(
+        const ExecutionPolicy& policy, const Query& query, DocumentOrdinal document_ordinal) const {
+    const auto status = documents_.statuses[document_ordinal];
+    const auto document_term_ids = GetDocumentTermIds(document_ordinal);
+    const std::size_t document_term_count = static_cast<std::size_t>(
+            document_term_ids.end() - document_term_ids.begin());
 
     std::vector<std::string_view> matched_words;
-    auto is_that_document_has_word = [&word_frequencies_in_that_documents](const auto word_view) {
-        return word_frequencies_in_that_documents.count(word_view) > 0;
+    const auto get_words = [this, &matched_words](const std::vector<TermId>& term_ids) {
+        matched_words.resize(term_ids.size());
+        std::transform(
+                term_ids.begin(), term_ids.end(),
+                matched_words.begin(),
+                [this](const TermId term_id) {
+                    return term_dictionary_.GetTerm(term_id);
+                });
+        // Term ids follow the order the words were added in, words are returned in lexicographic order.
+        std::sort(matched_words.begin(), matched_words.end());
+    };
+
+    if constexpr (std::is_same_v<ExecutionPolicy, std::execution::sequenced_policy>) {
+        // Terms of the query are sorted and unique, as terms of the document are,
+        // so matching is an intersection of sorted sets.
+        const bool that_document_has_minus_word = query.excluded_documents
+                ? query.excluded_documents->Test(static_cast<std::size_t>(document_ordinal))
+                : set_intersection::Intersects(query.minus_terms.data(), query.minus_terms.size(),
+                                               document_term_ids.begin(), document_term_count);
+        if (!that_document_has_minus_word) {
+            std::vector<TermId> matched_terms(std::min(query.plus_terms.size(), document_term_count));
+            matched_terms.resize(set_intersection::Intersect(query.plus_terms.data(), query.plus_terms.size(),
+                                                             document_term_ids.begin(), document_term_count,
+                                                             matched_terms.data()));
+            get_words(matched_terms);
+        }
+        return make_tuple(std::move(matched_words), status);
+    }
+
+    auto is_that_document_has_term = [&document_term_ids](const TermId term_id) {
+        return std::binary_search(document_term_ids.begin(), document_term_ids.end(), term_id);
     };
 
-    const bool that_document_has_minus_word = std::any_of(
-            std::execution::par,
-            query.minus_words.begin(), query.minus_words.end(),
-            is_that_document_has_word);
+    std::atomic_bool that_document_has_minus_word = false;
+    if (query.excluded_documents) {
+        that_document_has_minus_word = query.excluded_documents->Test(static_cast<std::size_t>(document_ordinal));
+    } else {
+        search_execution::ParallelFor(
+                policy, query.minus_terms.size(),
+                [&](const std::size_t index) {
+                    if (!that_document_has_minus_word.load(std::memory_order_relaxed)
+                            && is_that_document_has_term(query.minus_terms[index])) {
+                        that_document_has_minus_word.store(true, std::memory_order_relaxed);
+                    }
+                });
+    }
     if (that_document_has_minus_word) {
-        return make_tuple(std::move(matched_words), document_data.status);
+        return make_tuple(std::move(matched_words), status);
+    }
+
+    // Bytes instead of `std::vector<bool>`, so that workers write to distinct memory locations.
+    std::vector<char> is_matched(query.plus_terms.size());
+    search_execution::ParallelFor(
+            policy, query.plus_terms.size(),
+            [&](const std::size_t index) {
+                is_matched[index] = is_that_document_has_term(query.plus_terms[index]);
+            });
+    std::vector<TermId> matched_terms;
+    for (std::size_t index = 0; index < query.plus_terms.size(); ++index) {
+        if (is_matched[index]) {
+            matched_terms.push_back(query.plus_terms[index]);
+        }
+    }
+    RemoveDuplicateTerms(policy, matched_terms);
+    get_words(matched_terms);
+
+    return make_tuple(std::move(matched_words), status);
+}
+
+// Result cache
+
+void SearchServer::EnableResultCache(std::size_t capacity, std::size_t shard_count) {
+    result_cache_.emplace(capacity, shard_count);
+}
+
+void SearchServer::DisableResultCache() noexcept {
+    result_cache_.reset();
+}
+
+[[nodiscard]] CacheStatistics SearchServer::GetResultCacheStatistics() const noexcept {
+    return result_cache_ ? result_cache_->GetStatistics() : CacheStatistics{};
+}
+
+[[nodiscard]] bool SearchServer::ResultCacheKey::operator==(const ResultCacheKey& other) const noexcept {
+    return generation == other.generation
+           && status == other.status
+           && result_count == other.result_count
+           && plus_terms == other.plus_terms
+           && minus_terms == other.minus_terms;
+}
+
+[[nodiscard]] std::size_t SearchServer::ResultCacheKeyHash::operator()(const ResultCacheKey& key) const noexcept {
+    std::size_t hash = std::hash<std::uint64_t>{}(key.generation);
+    HashCombine(hash, static_cast<std::size_t>(key.status));
+    HashCombine(hash, key.result_count);
+    for (const TermId term_id : key.plus_terms) {
+        HashCombine(hash, term_id);
+    }
+    // Separates plus terms from minus terms.
+    HashCombine(hash, key.plus_terms.size());
+    for (const TermId term_id : key.minus_terms) {
+        HashCombine(hash, term_id);
+    }
+    return hash;
+}
+
+[[nodiscard]] SearchServer::StatusFilter SearchServer::MakeStatusFilter(DocumentStatus status) const noexcept {
+    return StatusFilter{&documents_.status_bitmaps[static_cast<std::size_t>(status)]};
+}
+
+[[nodiscard]] bool SearchServer::IsMoreRelevant(const Document& lhs, const Document& rhs) noexcept {
+    if (std::abs(lhs.relevance - rhs.relevance) < ERROR_MARGIN) {
+        if (lhs.rating != rhs.rating) {
+            return lhs.rating > rhs.rating;
+        }
+        return lhs.id < rhs.id;
+    }
+    return lhs.relevance > rhs.relevance;
+}
+
+[[nodiscard]] Bitmap SearchServer::ComputeExcludedDocuments(const Query& query) const {
+    if (query.minus_terms.empty()) {
+        return Bitmap{};
+    }
+
+    Bitmap excluded_documents(documents_.ids.size());
+    for (const TermId minus_term_id : query.minus_terms) {
+        term_to_document_frequencies_[minus_term_id].ForEach(
+                [&excluded_documents](DocumentOrdinal document_ordinal, PostingList::TermCount /*term_count*/) {
+                    excluded_documents.Set(static_cast<std::size_t>(document_ordinal));
+                });
     }
+    return excluded_documents;
+}
+
+[[nodiscard]] const Bitmap& SearchServer::GetExcludedDocuments(const Query& query, Bitmap& storage) const {
+    if (query.excluded_documents) {
+        return *query.excluded_documents;
+    }
+    storage = ComputeExcludedDocuments(query);
+    return storage;
+}
 
-    matched_words.resize(query.plus_words.size());
-    auto begin_of_matched_words_to_remove = std::copy_if(
-            query.plus_words.begin(), query.plus_words.end(),
-            matched_words.begin(),
-            is_that_document_has_word);
+[[nodiscard]] double SearchServer::GetInverseDocumentFrequency(const Query& query,
+                                                               std::size_t plus_term_index) const {
+    if (!query.plus_term_idfs.empty()) {
+        return query.plus_term_idfs[plus_term_index];
+    }
+    return ComputeInverseDocumentFrequency(term_document_counts_[query.plus_terms[plus_term_index]]);
+}
 
-    matched_words.erase(begin_of_matched_words_to_remove, matched_words.end());
-    RemoveDuplicateWords(std::execution::par, matched_words);
+[[nodiscard]] bool SearchServer::IsPruningEfficient(const Query& query) const {
+    if (query.plus_terms.size() > PRUNING_MAX_TERM_COUNT) {
+        return false;
+    }
+    const double min_posting_count = PRUNING_MIN_DOCUMENT_SHARE * GetDocumentCount();
+    return std::any_of(query.plus_terms.begin(), query.plus_terms.end(),
+                       [this, min_posting_count](const TermId plus_term_id) {
+                           return term_document_counts_[plus_term_id] >= min_posting_count;
+                       });
+}
 
-    return make_tuple(std::move(matched_words), document_data.status);
+[[nodiscard]] search_execution::QueryCost SearchServer::EstimateQueryCost(const Query& query) const {
+    search_execution::QueryCost cost;
+    cost.term_count = query.plus_terms.size();
+    // Removed documents are skipped before scoring, so only the live postings are counted.
+    cost.document_count = document_id_to_ordinal_.size();
+    for (const TermId plus_term_id : query.plus_terms) {
+        const std::size_t posting_count = term_document_counts_[plus_term_id];
+        cost.posting_count += posting_count;
+        cost.max_posting_count = std::max(cost.max_posting_count, posting_count);
+    }
+    return cost;
 }
 
 [[nodiscard]] std::vector<Document> SearchServer::PrepareResult(
-        const std::map<int, double>& document_to_relevance) const {
-    std::vector<Document> result;
-    result.reserve(document_to_relevance.size());
-    for (const auto [document_id, relevance] : document_to_relevance) {
-        result.emplace_back(document_id, relevance, documents_.at(document_id).rating);
+        const ScoreAccumulator& document_to_relevance, std::size_t result_count) const {
+    TopK<Document, decltype(&IsMoreRelevant)> top_documents(result_count, &IsMoreRelevant);
+    document_to_relevance.ForEach([this, &top_documents](DocumentOrdinal document_ordinal, double relevance) {
+        top_documents.Push({documents_.ids[document_ordinal], relevance, documents_.ratings[document_ordinal]});
+    });
+    return std::move(top_documents).Release();
+}
+
+[[nodiscard]] std::vector<Document> SearchServer::SelectTopDocuments(
+        const ScoreAccumulator& document_to_relevance, DocumentOrdinal first_ordinal,
+        std::size_t result_count) const {
+    TopK<Document, decltype(&IsMoreRelevant)> top_documents(result_count, &IsMoreRelevant);
+    document_to_relevance.ForEach([this, first_ordinal, &top_documents](DocumentOrdinal offset, double relevance) {
+        const DocumentOrdinal document_ordinal = first_ordinal + offset;
+        top_documents.Push({documents_.ids[document_ordinal], relevance, documents_.ratings[document_ordinal]});
+    });
+    return std::move(top_documents).Release();
+}
+
+[[nodiscard]] std::vector<Document> SearchServer::MergeTopDocuments(
+        const std::vector<std::vector<Document>>& partial_top_documents, std::size_t result_count) {
+    TopK<Document, decltype(&IsMoreRelevant)> top_documents(result_count, &IsMoreRelevant);
+    for (const auto& documents : partial_top_documents) {
+        for (const auto& document : documents) {
+            top_documents.Push(document);
+        }
     }
-    return result;
+    return std::move(top_documents).Release();
 }
 
 // Checks
 
 void SearchServer::StringHasNotAnyForbiddenChars(std::string_view s) {
-    if (std::any_of(s.begin(), s.end(),
-                    [](const char c) {
-                        return iscntrl(static_cast<unsigned char>(c));
-                    })) {
+    CheckNoForbiddenCharsFound(HasControlChars(s));
+}
+
+void SearchServer::CheckNoForbiddenCharsFound(bool forbidden_chars_found) {
+    if (forbidden_chars_found) {
         throw std::invalid_argument("Stop words contain forbidden characters from 0x00 to 0x1F"s);
     }
 }
@@ -225,13 +754,13 @@ void SearchServer::CheckDocumentIdIsNotNegative(int document_id) {
 }
 
 void SearchServer::CheckDocumentIdDoesntExist(int document_id) const {
-    if (documents_.count(document_id) > 0) {
+    if (document_id_to_ordinal_.count(document_id) > 0) {
         throw std::invalid_argument("The passed document id already exists"s);
     }
 }
 
 void SearchServer::CheckDocumentIdExists(int document_id) const {
-    if (documents_.count(document_id) == 0) {
+    if (document_id_to_ordinal_.count(document_id) == 0) {
         throw std::invalid_argument("The passed document id doesn't exist"s);
     }
 }
@@ -240,6 +769,29 @@ void SearchServer::CheckDocumentIdExists(int document_id) const {
     return stop_words_.count(word) > 0;
 }
 
+// Lookup
+
+[[nodiscard]] std::optional<SearchServer::DocumentOrdinal> SearchServer::FindDocumentOrdinal(int document_id) const {
+    if (auto iter = document_id_to_ordinal_.find(document_id); iter != document_id_to_ordinal_.end()) {
+        return iter->second;
+    }
+    return std::nullopt;
+}
+
+[[nodiscard]] std::optional<SearchServer::TermId> SearchServer::FindPresentTerm(std::string_view word) const {
+    if (const auto term_id = term_dictionary_.Find(word); term_id && term_document_counts_[*term_id] > 0) {
+        return term_id;
+    }
+    return std::nullopt;
+}
+
+[[nodiscard]] BorrowedRange<const SearchServer::TermId*> SearchServer::GetDocumentTermIds(
+        DocumentOrdinal document_ordinal) const noexcept {
+    const TermId* term_ids = documents_.term_ids.data();
+    return {term_ids + documents_.term_offsets[document_ordinal],
+            term_ids + documents_.term_offsets[document_ordinal + 1]};
+}
+
 // Metric computation
 
 [[nodiscard]] int SearchServer::ComputeAverageRating(const std::vector<int>& ratings) {
@@ -256,16 +808,35 @@ void SearchServer::CheckDocumentIdExists(int document_id) const {
 
 // Parsing
 
-std::vector<std::string> SearchServer::SplitIntoWordsNoStop(std::string_view text) const {
-    std::vector<std::string> result;
-    auto words = SplitIntoWords(text);
-    for (auto& word : words) {
-        StringHasNotAnyForbiddenChars(word);
-        if (!IsStopWord(word)) {
-            result.push_back(std::move(word));
+[[nodiscard]] SearchServer::Query SearchServer::ResolveQuery(const std::vector<std::string>& plus_words,
+                                                             const std::vector<std::string>& minus_words) const {
+    Query query;
+    for (const auto& [words, term_ids] : {std::pair{&plus_words, &query.plus_terms},
+                                          std::pair{&minus_words, &query.minus_terms}}) {
+        for (const auto& word : *words) {
+            if (const auto term_id = FindPresentTerm(word)) {
+                term_ids->push_back(*term_id);
+            }
         }
+        // Terms are ordered as `ParseQuery` orders them, so relevances are summed up in the same order.
+        RemoveDuplicateTerms(std::execution::seq, *term_ids);
+    }
+    query.plus_term_idfs.reserve(query.plus_terms.size());
+    for (const TermId plus_term_id : query.plus_terms) {
+        query.plus_term_idfs.push_back(
+                ComputeInverseDocumentFrequency(term_document_counts_[plus_term_id]));
+    }
+    query.excluded_documents = ComputeExcludedDocuments(query);
+    return query;
+}
+
+[[nodiscard]] const SearchServer::Query& SearchServer::GetQuery(const PreparedQuery& prepared_query,
+                                                                Query& storage) const {
+    if (prepared_query.search_server_ == this && prepared_query.generation_ == generation_) {
+        return prepared_query.query_;
     }
-    return result;
+    storage = ResolveQuery(prepared_query.plus_words_, prepared_query.minus_words_);
+    return storage;
 }
 
 [[nodiscard]] SearchServer::QueryWord SearchServer::ParseQueryWord(std::string_view word) const {
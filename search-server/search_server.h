@@ -2,38 +2,132 @@
 
 #include "document.h"
 #include "string_processing.h"
-#include "concurrent_map.h"
+#include "posting_list.h"
+#include "term_dictionary.h"
+#include "key_iterator.h"
+#include "bitmap.h"
+#include "borrowed_range.h"
+#include "top_k.h"
+#include "score_accumulator.h"
+#include "execution_policy.h"
+#include "lru_cache.h"
+#include "index_file.h"
+#include "write_ahead_log.h"
 
 #include <algorithm>
+#include <array>
 #include <execution>
 #include <cmath>
+#include <limits>
 #include <map>
+#include <numeric>
+#include <optional>
 #include <set>
 #include <string_view>
 #include <string>
 #include <tuple>
+#include <utility>
 #include <vector>
 #include <thread>
+#include <cstdint>
 
 class SearchServer {
+public:
+    inline static constexpr std::size_t DEFAULT_RESULT_DOCUMENT_COUNT = 5;
+    inline static constexpr std::size_t DEFAULT_RESULT_CACHE_SHARD_COUNT = 16;
+    inline static constexpr std::size_t DEFAULT_ADD_CHECKPOINT_DOCUMENT_COUNT = 10'000;
+    inline static constexpr double DEFAULT_MAX_REMOVED_POSTING_SHARE = 0.25;
+    inline static constexpr double DEFAULT_MAX_REMOVED_DOCUMENT_SHARE = 0.5;
+
 private:
-    inline static constexpr int MAX_RESULT_DOCUMENT_COUNT = 5;
     inline static constexpr double ERROR_MARGIN = 1e-6;
+    inline static constexpr std::size_t DOCUMENT_STATUS_COUNT = 4;
+    // Dynamic pruning is used if a query term occurs in at least this share of documents
+    // and the query has at most this number of plus terms.
+    inline static constexpr double PRUNING_MIN_DOCUMENT_SHARE = 0.125;
+    inline static constexpr std::size_t PRUNING_MAX_TERM_COUNT = 8;
+
+    static_assert(static_cast<std::size_t>(DocumentStatus::REMOVED) + 1 == DOCUMENT_STATUS_COUNT);
 
-    struct DocumentData {
-        std::map<std::string_view, double> word_frequencies;
-        int rating;
+public:
+    using TermId = TermDictionary::TermId;
+
+private:
+    // Dense internal number of a document; posting lists refer to documents by their ordinals.
+    using DocumentOrdinal = int;
+
+    // Document attributes stored column-wise and indexed by document ordinal.
+    struct DocumentColumns {
+        std::vector<int> ids;
+        std::vector<int> ratings;
+        std::vector<DocumentStatus> statuses;
+        // Term frequency is a term count in the document multiplied by this value.
+        std::vector<double> inverse_word_counts;
+        // Forward index: the sorted term ids of a document and their counts in the document
+        // are [term_offsets[ordinal], term_offsets[ordinal + 1]) of `term_ids` and `term_counts`.
+        std::vector<std::size_t> term_offsets = {0};
+        std::vector<TermId> term_ids;
+        std::vector<PostingList::TermCount> term_counts;
+        // Ordinals of the present documents having a particular status.
+        std::array<Bitmap, DOCUMENT_STATUS_COUNT> status_bitmaps;
+        // Ordinals of the removed documents, whose postings may still be in posting lists.
+        Bitmap tombstones;
+    };
+
+    // A parsed query normalized to sorted unique plus and minus terms, along with the index generation,
+    // so results computed before any change of documents are never found.
+    struct ResultCacheKey {
+        std::uint64_t generation;
+        std::vector<TermId> plus_terms;
+        std::vector<TermId> minus_terms;
         DocumentStatus status;
+        std::size_t result_count;
+
+        [[nodiscard]] bool operator==(const ResultCacheKey& other) const noexcept;
+    };
+
+    struct ResultCacheKeyHash {
+        [[nodiscard]] std::size_t operator()(const ResultCacheKey& key) const noexcept;
     };
 
-    using Indices = std::map<int, DocumentData>;
-    // Storage for original words represented as std::string.
-    // Words in other containers except stop-words only refer to these.
-    using ReverseIndices = std::map<std::string, std::map<int, double>, std::less<>>;
+    using ResultCache = ShardedLruCache<ResultCacheKey, std::vector<Document>, ResultCacheKeyHash>;
+
+    using DocumentIdToOrdinal = std::map<int, DocumentOrdinal>;
+    using Indices = DocumentColumns;
+    // Posting lists indexed by term id.
+    using ReverseIndices = std::vector<PostingList>;
+
+    // Not copied along with the server, so a copy doesn't record its changes to the log of the original.
+    struct AttachedLog {
+        WriteAheadLog* log = nullptr;
+
+        AttachedLog() noexcept = default;
+
+        AttachedLog(const AttachedLog&) noexcept {
+        }
+
+        AttachedLog(AttachedLog&& other) noexcept
+                : log(std::exchange(other.log, nullptr)) {
+        }
+
+        AttachedLog& operator=(const AttachedLog&) noexcept {
+            log = nullptr;
+            return *this;
+        }
+
+        AttachedLog& operator=(AttachedLog&& other) noexcept {
+            log = std::exchange(other.log, nullptr);
+            return *this;
+        }
+    };
 
     using MatchingWordsAndDocStatus = std::tuple<std::vector<std::string_view>, DocumentStatus>;
 
 public:
+    using DocumentIdIterator = KeyIterator<DocumentIdToOrdinal::const_iterator>;
+
+    class PreparedQuery;
+
     // Constructors
 
     template<typename StringContainer, typename ValueType = typename std::decay_t<StringContainer>::value_type,
@@ -46,41 +140,154 @@ public:
 
     [[nodiscard]] int GetDocumentCount() const noexcept;
 
-    [[nodiscard]] const std::map<std::string_view, double>& GetWordFrequencies(int document_id) const;
+    [[nodiscard]] std::map<std::string_view, double> GetWordFrequencies(int document_id) const;
+
+    [[nodiscard]] std::map<TermId, double> GetTermFrequencies(int document_id) const;
+
+    /// Returns the sorted ids of the terms of the document.
+    [[nodiscard]] BorrowedRange<const TermId*> GetTermIds(int document_id) const;
 
     // Iterators
 
-    [[nodiscard]] std::set<int>::const_iterator begin() const noexcept;
-    [[nodiscard]] std::set<int>::const_iterator end() const noexcept;
+    [[nodiscard]] DocumentIdIterator begin() const noexcept;
+    [[nodiscard]] DocumentIdIterator end() const noexcept;
 
     // Modification
 
     void AddDocument(int document_id, std::string_view document, DocumentStatus status,
                      const std::vector<int>& ratings);
 
+    /// Adds the documents as `AddDocument` would add them one by one, including the exception
+    /// thrown for the first invalid document, after which the following documents aren't added.
+    /// Documents are tokenized in parallel according to the policy and appended to the document columns in order,
+    /// then their postings are inverted and merged into posting lists in bulk, in parallel by terms.
+    /// At most `checkpoint_document_count` tokenized documents are kept before they are merged,
+    /// which bounds the memory used in addition to the index; zero means the whole batch.
+    void AddDocuments(const std::vector<DocumentToAdd>& documents,
+                      std::size_t checkpoint_document_count = DEFAULT_ADD_CHECKPOINT_DOCUMENT_COUNT);
+
+    template<typename ExecutionPolicy>
+    void AddDocuments(const ExecutionPolicy& policy, const std::vector<DocumentToAdd>& documents,
+                      std::size_t checkpoint_document_count = DEFAULT_ADD_CHECKPOINT_DOCUMENT_COUNT);
+
+    /// Marks the document with a tombstone: it is found no more and document frequencies of its words
+    /// are decreased at once, so relevances are the same as if the document had never been added,
+    /// but its postings stay in posting lists until they are merged out by the compaction,
+    /// see `SetCompactionThresholds`. The parallel overloads compact posting lists in parallel.
     void RemoveDocument(int document_id);
     void RemoveDocument(const std::execution::sequenced_policy&, int document_id);
     void RemoveDocument(const std::execution::parallel_policy&, int document_id);
+    void RemoveDocument(const search_execution::ThreadPoolPolicy& pool_policy, int document_id);
+
+    /// Removes the documents as `RemoveDocument` would remove them one by one, ignoring absent ids,
+    /// but every posting list of their words is visited once for all of them: posting lists crossing
+    /// the compaction threshold are shrunk at once, the workers of the policy shrink different lists.
+    template<typename DocumentIds>
+    void RemoveDocuments(const DocumentIds& document_ids);
+
+    template<typename ExecutionPolicy, typename DocumentIds>
+    void RemoveDocuments(const ExecutionPolicy& policy, const DocumentIds& document_ids);
+
+    /// Removes the documents for which `predicate(document_id, status, rating)` is true, see `RemoveDocuments`.
+    template<typename Predicate>
+    void RemoveDocumentsIf(Predicate predicate);
+
+    template<typename ExecutionPolicy, typename Predicate>
+    void RemoveDocumentsIf(const ExecutionPolicy& policy, Predicate predicate);
+
+    /// Rewrites the posting lists having postings of removed documents without them, the workers
+    /// of the policy rewrite different lists. Words left without postings are released.
+    /// Then removed documents are dropped from the document columns and the remaining documents
+    /// are renumbered, so the index takes as much memory as if the removed ones had never been added.
+    /// Search results are not changed.
+    void CompactIndex();
+
+    template<typename ExecutionPolicy>
+    void CompactIndex(const ExecutionPolicy& policy);
+
+    /// Sets when `RemoveDocument` compacts the index by itself. A posting list is rewritten as soon as
+    /// postings of removed documents make more than `max_removed_posting_share` of its postings,
+    /// which costs amortized O(1) per removed posting and keeps scoring from wading through them.
+    /// The whole index is compacted as `CompactIndex` does as soon as removed documents make more than
+    /// `max_removed_document_share` of the documents kept in the index. A share of 1 disables the compaction.
+    /// Throws `std::invalid_argument` if a share is negative.
+    void SetCompactionThresholds(double max_removed_posting_share = DEFAULT_MAX_REMOVED_POSTING_SHARE,
+                                 double max_removed_document_share = DEFAULT_MAX_REMOVED_DOCUMENT_SHARE);
+
+    /// Re-encodes all posting lists; posting lists of new words use the same encoding.
+    /// The compressed encoding trades some scoring time and update time for a smaller index.
+    void SetPostingListEncoding(PostingListEncoding encoding);
+
+    // Persistence
+
+    /// Writes the index to a versioned binary file, see `index_file`; the result cache isn't written.
+    /// The file replaces the old one atomically and is durable on return, so only then may the log
+    /// recording to the server be truncated.
+    void SaveIndex(const std::string& path) const;
+
+    /// Opens an index written by `SaveIndex`. The file is mapped into memory and every array of the index
+    /// is copied from the mapped pages as a whole, so no document is tokenized again.
+    [[nodiscard]] static SearchServer LoadIndex(const std::string& path);
+
+    /// Records every following change of documents in the log before applying it; null stops recording.
+    /// The log must outlive the server or be detached; copies of the server don't record to it.
+    /// Changes are numbered on from the last change recorded by the server, so after a crash
+    /// the index saved by `SaveIndex` and the log it was recording to restore the server.
+    void AttachWriteAheadLog(WriteAheadLog* write_ahead_log) noexcept;
+
+    /// Applies the changes recorded in the log after the ones the server already has,
+    /// such as the ones recorded after the index was saved, up to a record torn by a crash.
+    void ReplayWriteAheadLog(const std::string& path);
 
     // Search
 
+    // `result_count` is the maximum number of the most relevant documents to return.
+
     template<typename Predicate>
-    [[nodiscard]] std::vector<Document> FindTopDocuments(std::string_view raw_query, Predicate predicate) const;
+    [[nodiscard]] std::vector<Document> FindTopDocuments(
+            std::string_view raw_query, Predicate predicate,
+            std::size_t result_count = DEFAULT_RESULT_DOCUMENT_COUNT) const;
 
     template<typename ExecutionPolicy, typename Predicate>
-    [[nodiscard]] std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy,
-                                                         std::string_view raw_query, Predicate predicate) const;
+    [[nodiscard]] std::vector<Document> FindTopDocuments(
+            const ExecutionPolicy& policy, std::string_view raw_query, Predicate predicate,
+            std::size_t result_count = DEFAULT_RESULT_DOCUMENT_COUNT) const;
 
-    [[nodiscard]] std::vector<Document> FindTopDocuments(std::string_view raw_query,
-                                                         DocumentStatus document_status) const;
+    [[nodiscard]] std::vector<Document> FindTopDocuments(
+            std::string_view raw_query, DocumentStatus document_status,
+            std::size_t result_count = DEFAULT_RESULT_DOCUMENT_COUNT) const;
 
     template<typename ExecutionPolicy>
-    [[nodiscard]] std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy,
-                                                         std::string_view raw_query,
-                                                         DocumentStatus document_status) const;
+    [[nodiscard]] std::vector<Document> FindTopDocuments(
+            const ExecutionPolicy& policy, std::string_view raw_query, DocumentStatus document_status,
+            std::size_t result_count = DEFAULT_RESULT_DOCUMENT_COUNT) const;
 
     [[nodiscard]] std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
 
+    /// Parses the query once, so that it can be executed many times.
+    [[nodiscard]] PreparedQuery PrepareQuery(std::string_view raw_query) const;
+
+    template<typename Predicate>
+    [[nodiscard]] std::vector<Document> FindTopDocuments(
+            const PreparedQuery& prepared_query, Predicate predicate,
+            std::size_t result_count = DEFAULT_RESULT_DOCUMENT_COUNT) const;
+
+    template<typename ExecutionPolicy, typename Predicate>
+    [[nodiscard]] std::vector<Document> FindTopDocuments(
+            const ExecutionPolicy& policy, const PreparedQuery& prepared_query, Predicate predicate,
+            std::size_t result_count = DEFAULT_RESULT_DOCUMENT_COUNT) const;
+
+    [[nodiscard]] std::vector<Document> FindTopDocuments(
+            const PreparedQuery& prepared_query, DocumentStatus document_status,
+            std::size_t result_count = DEFAULT_RESULT_DOCUMENT_COUNT) const;
+
+    template<typename ExecutionPolicy>
+    [[nodiscard]] std::vector<Document> FindTopDocuments(
+            const ExecutionPolicy& policy, const PreparedQuery& prepared_query, DocumentStatus document_status,
+            std::size_t result_count = DEFAULT_RESULT_DOCUMENT_COUNT) const;
+
+    [[nodiscard]] std::vector<Document> FindTopDocuments(const PreparedQuery& prepared_query) const;
+
     template<typename ExecutionPolicy>
     [[nodiscard]] std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy,
                                                          std::string_view raw_query) const;
@@ -93,16 +300,82 @@ public:
     [[nodiscard]] MatchingWordsAndDocStatus MatchDocument(const std::execution::parallel_policy&,
                                                           std::string_view raw_query, int document_id) const;
 
+    [[nodiscard]] MatchingWordsAndDocStatus MatchDocument(const search_execution::ThreadPoolPolicy& pool_policy,
+                                                          std::string_view raw_query, int document_id) const;
+
+    [[nodiscard]] MatchingWordsAndDocStatus MatchDocument(const search_execution::AdaptivePolicy& adaptive_policy,
+                                                          std::string_view raw_query, int document_id) const;
+
+    [[nodiscard]] MatchingWordsAndDocStatus MatchDocument(const PreparedQuery& prepared_query,
+                                                          int document_id) const;
+
+    /// Matches the query with all documents of `document_ids` at once: the query is parsed once
+    /// and the postings of its words are intersected with the documents, so the workers of the policy
+    /// match disjoint parts of the documents. Returns the results in the order of `document_ids`.
+    template<typename DocumentIds>
+    [[nodiscard]] std::vector<MatchingWordsAndDocStatus> MatchDocuments(std::string_view raw_query,
+                                                                        const DocumentIds& document_ids) const;
+
+    template<typename ExecutionPolicy, typename DocumentIds>
+    [[nodiscard]] std::vector<MatchingWordsAndDocStatus> MatchDocuments(const ExecutionPolicy& policy,
+                                                                        std::string_view raw_query,
+                                                                        const DocumentIds& document_ids) const;
+
+    template<typename DocumentIds>
+    [[nodiscard]] std::vector<MatchingWordsAndDocStatus> MatchDocuments(const PreparedQuery& prepared_query,
+                                                                        const DocumentIds& document_ids) const;
+
+    template<typename ExecutionPolicy, typename DocumentIds>
+    [[nodiscard]] std::vector<MatchingWordsAndDocStatus> MatchDocuments(const ExecutionPolicy& policy,
+                                                                        const PreparedQuery& prepared_query,
+                                                                        const DocumentIds& document_ids) const;
+
+    /// Estimates the cost of scoring the query, which `search_execution::adaptive` chooses the execution by.
+    [[nodiscard]] search_execution::QueryCost EstimateQueryCost(std::string_view raw_query) const;
+
+    // Result cache
+
+    /// Caches the results of the `DocumentStatus` overloads of `FindTopDocuments` for up to `capacity` queries.
+    /// Queries with the same plus and minus words, status and result count share an entry regardless of
+    /// the order and repetitions of the words. Adding or removing a document invalidates all entries.
+    void EnableResultCache(std::size_t capacity, std::size_t shard_count = DEFAULT_RESULT_CACHE_SHARD_COUNT);
+
+    void DisableResultCache() noexcept;
+
+    [[nodiscard]] CacheStatistics GetResultCacheStatistics() const noexcept;
+
 private:
     std::set<std::string, std::less<>> stop_words_;
-    std::set<int> document_ids_;
+    // Documents are iterated over in ascending order of their ids.
+    DocumentIdToOrdinal document_id_to_ordinal_;
+    // Ordinals are never reused; removed documents are cleared from the status bitmaps and marked
+    // with tombstones, other columns, including the forward index, keep their values.
     Indices documents_;
-    ReverseIndices word_to_document_frequencies_;
+    // Storage for original words of all documents.
+    // Other containers except stop-words refer to them by term id.
+    TermDictionary term_dictionary_;
+    ReverseIndices term_to_document_frequencies_;
+    // Number of the present documents containing a term, indexed by term id; unlike the size
+    // of a posting list, it doesn't count postings of removed documents left until compaction.
+    std::vector<std::size_t> term_document_counts_;
+    PostingListEncoding posting_list_encoding_ = PostingListEncoding::PLAIN;
+    double max_removed_posting_share_ = DEFAULT_MAX_REMOVED_POSTING_SHARE;
+    double max_removed_document_share_ = DEFAULT_MAX_REMOVED_DOCUMENT_SHARE;
+    // Taken anew by construction and by every change of documents from a process-wide counter,
+    // so two servers have equal generations only if one is an unchanged copy of the other,
+    // even after assignment or `LoadIndex`.
+    std::uint64_t generation_ = NextGeneration();
+    // Sequence number of the last change recorded to a write-ahead log or replayed from it.
+    std::uint64_t log_sequence_number_ = 0;
+    AttachedLog write_ahead_log_;
+    mutable std::optional<ResultCache> result_cache_;
 
     // Checks
 
     static void StringHasNotAnyForbiddenChars(std::string_view s);
 
+    static void CheckNoForbiddenCharsFound(bool forbidden_chars_found);
+
     static void CheckDocumentIdIsNotNegative(int document_id);
 
     void CheckDocumentIdDoesntExist(int document_id) const;
@@ -111,6 +384,83 @@ private:
 
     [[nodiscard]] bool IsStopWord(std::string_view word) const;
 
+    // Lookup
+
+    [[nodiscard]] std::optional<DocumentOrdinal> FindDocumentOrdinal(int document_id) const;
+
+    /// Returns the id of the word if some present document contains it.
+    [[nodiscard]] std::optional<TermId> FindPresentTerm(std::string_view word) const;
+
+    [[nodiscard]] BorrowedRange<const TermId*> GetDocumentTermIds(DocumentOrdinal document_ordinal) const noexcept;
+
+    // Modification
+
+    // Words of a document looked up without modifying the server, so documents can be tokenized in parallel.
+    struct TokenizedDocument {
+        // Ids of the words found in the dictionary, in the order of the words.
+        std::vector<TermId> term_ids;
+        // Words missing from the dictionary; they are interned when the document is added.
+        std::vector<std::string_view> new_words;
+        bool has_forbidden_chars = false;
+    };
+
+    [[nodiscard]] TokenizedDocument TokenizeDocument(std::string_view document) const;
+
+    void AddTokenizedDocument(int document_id, std::string_view document, TokenizedDocument tokenized_document,
+                              DocumentStatus status, const std::vector<int>& ratings);
+
+    /// Checks and records the document, then appends its columns and its forward index
+    /// and counts it in document frequencies, but doesn't add its postings yet.
+    DocumentOrdinal AppendDocument(int document_id, std::string_view document, TokenizedDocument tokenized_document,
+                                   DocumentStatus status, const std::vector<int>& ratings);
+
+    /// Adds the postings of an appended document from its forward index.
+    void AddPostings(DocumentOrdinal document_ordinal);
+
+    /// Adds the postings of all documents appended since the one with `first_document_ordinal`.
+    /// Every worker inverts its own range of the documents into a sparse partial index sorted by terms,
+    /// then every worker appends the partial postings of its own share of the occurring terms
+    /// to their posting lists, so each posting list is extended in one pass and no two workers touch the same one.
+    template<typename ExecutionPolicy>
+    void MergePostings(const ExecutionPolicy& policy, DocumentOrdinal first_document_ordinal);
+
+    template<typename ExecutionPolicy>
+    void RemoveDocumentInParallel(const ExecutionPolicy& policy, int document_id);
+
+    /// Marks the document with a tombstone and decreases document frequencies of its words.
+    /// Returns the ordinal of the document if it was present.
+    std::optional<DocumentOrdinal> MarkDocumentRemoved(int document_id);
+
+    void LogRemoveDocument(int document_id);
+
+    void ClearDocument(DocumentOrdinal document_ordinal);
+
+    /// Rewrites the posting lists of the terms without postings of removed documents in parallel,
+    /// then releases the terms left without postings.
+    template<typename ExecutionPolicy>
+    void CompactPostingLists(const ExecutionPolicy& policy, const std::vector<TermId>& term_ids);
+
+    /// Erases the postings of removed documents from the posting list of the term.
+    void EraseRemovedPostings(TermId term_id);
+
+    /// Compacts the posting lists of the terms of removed documents, whose postings crossed the threshold,
+    /// or the whole index if removed documents crossed their threshold.
+    template<typename ExecutionPolicy, typename TermIds>
+    void CompactAfterRemoval(const ExecutionPolicy& policy, const TermIds& term_ids);
+
+    /// Drops removed documents from the document columns and renumbers the remaining ones in the same order.
+    /// Posting lists must have no postings of removed documents.
+    template<typename ExecutionPolicy>
+    void RenumberDocuments(const ExecutionPolicy& policy);
+
+    /// Returns new ordinals indexed by old ones; removed documents get no ordinal.
+    [[nodiscard]] std::vector<DocumentOrdinal> DropRemovedDocuments();
+
+    void ReleaseTerm(TermId term_id);
+
+    /// Returns a generation never returned before in the process.
+    [[nodiscard]] static std::uint64_t NextGeneration() noexcept;
+
     // Metric computation
 
     [[nodiscard]] static int ComputeAverageRating(const std::vector<int>& ratings);
@@ -119,17 +469,19 @@ private:
 
     // Parsing
 
-    [[nodiscard]] std::vector<std::string> SplitIntoWordsNoStop(std::string_view text) const;
-
     struct QueryWord {
         std::string_view content;
         bool is_minus;
         bool is_stop;
     };
 
+    // Words that are absent from all documents are omitted from the query.
     struct Query {
-        std::vector<std::string_view> plus_words;
-        std::vector<std::string_view> minus_words;
+        std::vector<TermId> plus_terms;
+        std::vector<TermId> minus_terms;
+        // Computed once by `PrepareQuery`, otherwise the search computes them on every call.
+        std::vector<double> plus_term_idfs;
+        std::optional<Bitmap> excluded_documents;
     };
 
     [[nodiscard]] QueryWord ParseQueryWord(std::string_view word) const;
@@ -140,25 +492,170 @@ private:
     [[nodiscard]] Query ParseQuery(const ExecutionPolicy& policy,
                                    std::string_view text, WordsRepeatable words_can_be_repeated) const;
 
+    template<typename ExecutionPolicy>
+    static void RemoveDuplicateTerms(const ExecutionPolicy& policy, std::vector<TermId>& term_ids);
+
+    /// Resolves sorted unique words into a query with precomputed IDFs and excluded documents.
+    [[nodiscard]] Query ResolveQuery(const std::vector<std::string>& plus_words,
+                                     const std::vector<std::string>& minus_words) const;
+
+    /// Returns the query of the prepared query if documents haven't changed since it was prepared,
+    /// otherwise resolves its words again into `storage`.
+    [[nodiscard]] const Query& GetQuery(const PreparedQuery& prepared_query, Query& storage) const;
+
     // Search
 
+    template<typename ExecutionPolicy>
+    [[nodiscard]] MatchingWordsAndDocStatus MatchDocumentInParallel(const ExecutionPolicy& policy,
+                                                                    std::string_view raw_query, int document_id) const;
+
+    // Words of the query are not required to be unique.
+    template<typename ExecutionPolicy>
+    [[nodiscard]] MatchingWordsAndDocStatus MatchQuery(const ExecutionPolicy& policy, const Query& query,
+                                                       DocumentOrdinal document_ordinal) const;
+
+    // A document to match with and the position of its result.
+    struct MatchTarget {
+        DocumentOrdinal document_ordinal;
+        std::size_t position;
+    };
+
+    /// Returns the documents sorted by ordinal.
+    template<typename DocumentIds>
+    [[nodiscard]] std::vector<MatchTarget> MakeMatchTargets(const DocumentIds& document_ids) const;
+
+    template<typename ExecutionPolicy>
+    [[nodiscard]] std::vector<MatchingWordsAndDocStatus> MatchQueryWithDocuments(
+            const ExecutionPolicy& policy, const Query& query, const std::vector<MatchTarget>& targets) const;
+
+    /// Searches with the result cache, if it's enabled.
+    template<typename ExecutionPolicy>
+    [[nodiscard]] std::vector<Document> FindTopDocumentsByStatus(const ExecutionPolicy& policy, const Query& query,
+                                                                 DocumentStatus document_status,
+                                                                 std::size_t result_count) const;
+
+    [[nodiscard]] search_execution::QueryCost EstimateQueryCost(const Query& query) const;
+
+    // Document filter of the `DocumentStatus` overloads: instead of calling a predicate
+    // for every posting, a posting is checked against the bitmap of the requested status.
+    struct StatusFilter {
+        const Bitmap* documents;
+    };
+
+    [[nodiscard]] StatusFilter MakeStatusFilter(DocumentStatus status) const noexcept;
+
+    template<typename Predicate>
+    [[nodiscard]] bool IsAccepted(const Predicate& predicate, DocumentOrdinal document_ordinal) const;
+
+    // Find all documents matching the query and select `result_count` of the most relevant ones.
+
     template<typename Predicate>
-    [[nodiscard]] std::vector<Document> FindAllDocuments(const Query& query, Predicate predicate) const;
+    [[nodiscard]] std::vector<Document> FindAllDocuments(const Query& query, Predicate predicate,
+                                                         std::size_t result_count) const;
 
     template<typename Predicate>
     [[nodiscard]] std::vector<Document> FindAllDocuments(const std::execution::sequenced_policy&,
-                                                         const Query& query, Predicate predicate) const;
+                                                         const Query& query, Predicate predicate,
+                                                         std::size_t result_count) const;
 
     template<typename Predicate>
     [[nodiscard]] std::vector<Document> FindAllDocuments(const std::execution::parallel_policy& par_policy,
-                                                         const Query& query, Predicate predicate) const;
+                                                         const Query& query, Predicate predicate,
+                                                         std::size_t result_count) const;
+
+    template<typename Predicate>
+    [[nodiscard]] std::vector<Document> FindAllDocuments(const search_execution::ThreadPoolPolicy& pool_policy,
+                                                         const Query& query, Predicate predicate,
+                                                         std::size_t result_count) const;
+
+    template<typename Predicate>
+    [[nodiscard]] std::vector<Document> FindAllDocuments(const search_execution::DocumentRangePolicy& range_policy,
+                                                         const Query& query, Predicate predicate,
+                                                         std::size_t result_count) const;
 
-    template<typename ExecutionPolicy, typename Map, typename Predicate>
-    void ComputeDocumentsRelevance(const ExecutionPolicy& policy,
-                                   Map& document_to_relevance,
-                                   const Query& query, Predicate predicate) const;
+    template<typename Predicate>
+    [[nodiscard]] std::vector<Document> FindAllDocuments(const search_execution::AdaptivePolicy& adaptive_policy,
+                                                         const Query& query, Predicate predicate,
+                                                         std::size_t result_count) const;
+
+    /// Inter-term parallelism: plus terms are shared among the workers of the policy.
+    template<typename ExecutionPolicy, typename Predicate>
+    [[nodiscard]] std::vector<Document> FindAllDocumentsByTerms(const ExecutionPolicy& policy,
+                                                                const Query& query, Predicate predicate,
+                                                                std::size_t result_count) const;
+
+    /// Splits ordinals of documents into `range_count` ranges and calls `score_range(accumulator, begin, end)`
+    /// for each range in parallel; the accumulator is keyed by ordinals decreased by `begin`.
+    /// Returns the most relevant documents of all ranges.
+    template<typename ExecutionPolicy, typename ScoreRange>
+    [[nodiscard]] std::vector<Document> SelectTopDocumentsByRanges(const ExecutionPolicy& policy,
+                                                                   std::size_t range_count, std::size_t result_count,
+                                                                   ScoreRange score_range) const;
+
+    /// Returns a bitmap of the ordinals of documents containing any minus word of the query.
+    /// Plus-word postings of these documents are skipped, so they are never scored.
+    [[nodiscard]] Bitmap ComputeExcludedDocuments(const Query& query) const;
+
+    /// Returns the bitmap of excluded documents of a prepared query or computes it into `storage`.
+    [[nodiscard]] const Bitmap& GetExcludedDocuments(const Query& query, Bitmap& storage) const;
+
+    [[nodiscard]] double GetInverseDocumentFrequency(const Query& query, std::size_t plus_term_index) const;
+
+    template<typename Map, typename Predicate>
+    void ComputeDocumentsRelevance(Map& document_to_relevance, const Query& query, Predicate predicate) const;
+
+    template<typename Map, typename Predicate>
+    void AccumulateTermRelevance(Map& document_to_relevance, TermId term_id, double idf,
+                                 const Bitmap& excluded_documents, const Predicate& predicate) const;
+
+    /// Document-at-a-time search with dynamic pruning (MaxScore with block-max bounds). Postings of
+    /// the plus terms are traversed together in ascending order of document ordinals. Terms whose
+    /// summed maximum scores can't beat the worst selected document don't produce candidates, they are
+    /// only probed for the candidates of other terms, and only while the maximum scores of the terms
+    /// and of their posting blocks leave the candidate a chance.
+    /// Returns the same documents as the exhaustive scoring does.
+    /// Pruning pays off when some of the query terms are frequent: their IDF is low,
+    /// so most of their postings are skipped. Long queries make most terms produce candidates,
+    /// then the exhaustive scoring into a dense accumulator is cheaper.
+    [[nodiscard]] bool IsPruningEfficient(const Query& query) const;
+
+    template<typename Predicate>
+    [[nodiscard]] std::vector<Document> FindTopDocumentsWithPruning(const Query& query, Predicate predicate,
+                                                                    std::size_t result_count) const;
+
+    /// Tells whether `lhs` must precede `rhs` in the search result. Documents of equal relevance
+    /// and rating are ordered by id, so the result doesn't depend on the order of scoring.
+    [[nodiscard]] static bool IsMoreRelevant(const Document& lhs, const Document& rhs) noexcept;
+
+    /// Selects `result_count` of the most relevant documents with a bounded heap,
+    /// avoiding sorting of all found documents.
+    [[nodiscard]] std::vector<Document> PrepareResult(
+            const ScoreAccumulator& document_to_relevance, std::size_t result_count) const;
+
+    /// Selects from an accumulator whose keys are ordinals decreased by `first_ordinal`.
+    [[nodiscard]] std::vector<Document> SelectTopDocuments(
+            const ScoreAccumulator& document_to_relevance, DocumentOrdinal first_ordinal,
+            std::size_t result_count) const;
+
+    /// Selects from the documents selected from disjoint parts of documents.
+    [[nodiscard]] static std::vector<Document> MergeTopDocuments(
+            const std::vector<std::vector<Document>>& partial_top_documents, std::size_t result_count);
+};
 
-    [[nodiscard]] std::vector<Document> PrepareResult(const std::map<int, double>& document_to_relevance) const;
+/// A query parsed once by `SearchServer::PrepareQuery` to be executed many times: it keeps the term ids
+/// of its words along with their IDFs and the documents excluded by its minus words.
+/// Once documents of the server change, every execution resolves the words again, as if the query was
+/// prepared anew, so the results are the same as of the raw query; prepare the query again to skip that.
+class SearchServer::PreparedQuery {
+private:
+    friend class SearchServer;
+
+    const SearchServer* search_server_ = nullptr;
+    std::uint64_t generation_ = 0;
+    // Sorted unique words.
+    std::vector<std::string> plus_words_;
+    std::vector<std::string> minus_words_;
+    Query query_;
 };
 
 // Search Server template implementation
@@ -179,75 +676,301 @@ SearchServer::SearchServer(StringContainer&& stop_words) {
     }
 }
 
+// Modification
+
+template<typename ExecutionPolicy>
+void SearchServer::AddDocuments(const ExecutionPolicy& policy, const std::vector<DocumentToAdd>& documents,
+                                std::size_t checkpoint_document_count) {
+    if (checkpoint_document_count == 0) {
+        checkpoint_document_count = std::max<std::size_t>(documents.size(), 1);
+    }
+    std::vector<TokenizedDocument> tokenized_documents;
+    for (std::size_t begin = 0; begin < documents.size(); begin += checkpoint_document_count) {
+        const std::size_t count = std::min(checkpoint_document_count, documents.size() - begin);
+        tokenized_documents.assign(count, TokenizedDocument{});
+        search_execution::ParallelFor(policy, count, [&](std::size_t index) {
+            tokenized_documents[index] = TokenizeDocument(documents[begin + index].text);
+        });
+        const auto first_document_ordinal = static_cast<DocumentOrdinal>(documents_.ids.size());
+        try {
+            for (std::size_t index = 0; index < count; ++index) {
+                const auto& document = documents[begin + index];
+                (void) AppendDocument(document.id, document.text, std::move(tokenized_documents[index]),
+                                      document.status, document.ratings);
+            }
+        } catch (...) {
+            // The documents before the invalid one are added.
+            MergePostings(policy, first_document_ordinal);
+            throw;
+        }
+        MergePostings(policy, first_document_ordinal);
+    }
+}
+
+template<typename ExecutionPolicy>
+void SearchServer::MergePostings(const ExecutionPolicy& policy, DocumentOrdinal first_document_ordinal) {
+    struct Posting {
+        TermId term_id;
+        DocumentOrdinal document_ordinal;
+        PostingList::TermCount term_count;
+    };
+
+    const auto document_count = documents_.ids.size() - static_cast<std::size_t>(first_document_ordinal);
+    if (document_count == 0) {
+        return;
+    }
+    const std::size_t worker_count = std::min(search_execution::GetWorkerCount(policy), document_count);
+
+    // Partial indexes hold only the terms of their documents, so the work depends on the postings
+    // of the checkpoint rather than on the size of the dictionary.
+    std::vector<std::vector<Posting>> partial_indexes(worker_count);
+    std::vector<std::vector<TermId>> partial_terms(worker_count);
+    search_execution::ParallelFor(policy, worker_count, [&](std::size_t worker) {
+        const auto range_begin = first_document_ordinal
+                + static_cast<DocumentOrdinal>(document_count * worker / worker_count);
+        const auto range_end = first_document_ordinal
+                + static_cast<DocumentOrdinal>(document_count * (worker + 1) / worker_count);
+        auto& postings = partial_indexes[worker];
+        postings.reserve(documents_.term_offsets[range_end] - documents_.term_offsets[range_begin]);
+        for (DocumentOrdinal document_ordinal = range_begin; document_ordinal < range_end; ++document_ordinal) {
+            for (std::size_t i = documents_.term_offsets[document_ordinal];
+                 i < documents_.term_offsets[document_ordinal + 1]; ++i) {
+                postings.push_back({documents_.term_ids[i], document_ordinal, documents_.term_counts[i]});
+            }
+        }
+        // The least significant digit radix sort by term ids is stable, so ordinals stay ascending within terms,
+        // and it needs as many passes as the greatest term id of the range has digits.
+        constexpr std::size_t DIGIT_BIT_COUNT = 11;
+        constexpr std::size_t DIGIT_MASK = (std::size_t(1) << DIGIT_BIT_COUNT) - 1;
+        const auto max_term_id = std::max_element(postings.begin(), postings.end(),
+                                                  [](const Posting& lhs, const Posting& rhs) {
+                                                      return lhs.term_id < rhs.term_id;
+                                                  });
+        std::vector<Posting> sorted_postings(postings.size());
+        for (std::size_t shift = 0; max_term_id != postings.end() && (max_term_id->term_id >> shift) != 0;
+             shift += DIGIT_BIT_COUNT) {
+            std::array<std::size_t, DIGIT_MASK + 2> digit_offsets{};
+            for (const auto& posting : postings) {
+                ++digit_offsets[((posting.term_id >> shift) & DIGIT_MASK) + 1];
+            }
+            std::partial_sum(digit_offsets.begin(), digit_offsets.end(), digit_offsets.begin());
+            for (const auto& posting : postings) {
+                sorted_postings[digit_offsets[(posting.term_id >> shift) & DIGIT_MASK]++] = posting;
+            }
+            postings.swap(sorted_postings);
+        }
+        for (const auto& posting : postings) {
+            if (partial_terms[worker].empty() || partial_terms[worker].back() != posting.term_id) {
+                partial_terms[worker].push_back(posting.term_id);
+            }
+        }
+    });
+
+    std::vector<TermId> terms;
+    for (const auto& range_terms : partial_terms) {
+        terms.insert(terms.end(), range_terms.begin(), range_terms.end());
+    }
+    std::sort(terms.begin(), terms.end());
+    terms.erase(std::unique(terms.begin(), terms.end()), terms.end());
+
+    // Every worker extends the posting lists of its own share of the terms, taking the postings
+    // of a term from the partial indexes in order of their ranges, so ordinals stay ascending.
+    search_execution::ParallelFor(policy, worker_count, [&](std::size_t worker) {
+        const auto terms_begin = terms.begin() + static_cast<std::ptrdiff_t>(terms.size() * worker / worker_count);
+        const auto terms_end = terms.begin() + static_cast<std::ptrdiff_t>(terms.size() * (worker + 1) / worker_count);
+        if (terms_begin == terms_end) {
+            return;
+        }
+        std::vector<typename std::vector<Posting>::const_iterator> cursors;
+        cursors.reserve(partial_indexes.size());
+        for (const auto& postings : partial_indexes) {
+            cursors.push_back(std::lower_bound(postings.begin(), postings.end(), *terms_begin,
+                                               [](const Posting& posting, TermId term_id) {
+                                                   return posting.term_id < term_id;
+                                               }));
+        }
+        for (auto term_iter = terms_begin; term_iter != terms_end; ++term_iter) {
+            auto& posting_list = term_to_document_frequencies_[*term_iter];
+            for (std::size_t range = 0; range < partial_indexes.size(); ++range) {
+                auto& cursor = cursors[range];
+                for (; cursor != partial_indexes[range].end() && cursor->term_id == *term_iter; ++cursor) {
+                    posting_list.Add(cursor->document_ordinal, cursor->term_count,
+                                     cursor->term_count * documents_.inverse_word_counts[cursor->document_ordinal]);
+                }
+            }
+        }
+    });
+}
+
+template<typename DocumentIds>
+void SearchServer::RemoveDocuments(const DocumentIds& document_ids) {
+    RemoveDocuments(std::execution::seq, document_ids);
+}
+
+template<typename ExecutionPolicy, typename DocumentIds>
+void SearchServer::RemoveDocuments(const ExecutionPolicy& policy, const DocumentIds& document_ids) {
+    // Terms of all removed documents are gathered without repetitions, so every posting list is compacted once.
+    std::vector<TermId> removed_terms;
+    Bitmap is_removed_term;
+    for (const int document_id : document_ids) {
+        const auto document_ordinal = MarkDocumentRemoved(document_id);
+        if (!document_ordinal) {
+            continue;
+        }
+        for (const TermId term_id : GetDocumentTermIds(*document_ordinal)) {
+            if (!is_removed_term.Test(term_id)) {
+                is_removed_term.Set(term_id);
+                removed_terms.push_back(term_id);
+            }
+        }
+    }
+    CompactAfterRemoval(policy, removed_terms);
+}
+
+template<typename Predicate>
+void SearchServer::RemoveDocumentsIf(Predicate predicate) {
+    RemoveDocumentsIf(std::execution::seq, predicate);
+}
+
+template<typename ExecutionPolicy, typename Predicate>
+void SearchServer::RemoveDocumentsIf(const ExecutionPolicy& policy, Predicate predicate) {
+    std::vector<int> document_ids;
+    for (const auto& [document_id, document_ordinal] : document_id_to_ordinal_) {
+        if (predicate(document_id, documents_.statuses[document_ordinal], documents_.ratings[document_ordinal])) {
+            document_ids.push_back(document_id);
+        }
+    }
+    RemoveDocuments(policy, document_ids);
+}
+
+template<typename ExecutionPolicy>
+void SearchServer::CompactIndex(const ExecutionPolicy& policy) {
+    std::vector<TermId> stale_terms;
+    for (std::size_t term_id = 0; term_id < term_to_document_frequencies_.size(); ++term_id) {
+        if (term_to_document_frequencies_[term_id].size() > term_document_counts_[term_id]) {
+            stale_terms.push_back(static_cast<TermId>(term_id));
+        }
+    }
+    CompactPostingLists(policy, stale_terms);
+
+    if (documents_.ids.size() > document_id_to_ordinal_.size()) {
+        RenumberDocuments(policy);
+    }
+}
+
+template<typename ExecutionPolicy>
+void SearchServer::CompactPostingLists(const ExecutionPolicy& policy, const std::vector<TermId>& term_ids) {
+    search_execution::ParallelFor(policy, term_ids.size(), [this, &term_ids](std::size_t index) {
+        EraseRemovedPostings(term_ids[index]);
+    });
+
+    for (const TermId term_id : term_ids) {
+        if (term_document_counts_[term_id] == 0) {
+            ReleaseTerm(term_id);
+        }
+    }
+}
+
+template<typename ExecutionPolicy, typename TermIds>
+void SearchServer::CompactAfterRemoval(const ExecutionPolicy& policy, const TermIds& term_ids) {
+    const auto removed_document_count = static_cast<double>(documents_.ids.size() - document_id_to_ordinal_.size());
+    if (removed_document_count > max_removed_document_share_ * static_cast<double>(documents_.ids.size())) {
+        CompactIndex(policy);
+        return;
+    }
+
+    std::vector<TermId> stale_terms;
+    for (const TermId term_id : term_ids) {
+        const auto posting_count = static_cast<double>(term_to_document_frequencies_[term_id].size());
+        const auto removed_posting_count = posting_count - static_cast<double>(term_document_counts_[term_id]);
+        if (removed_posting_count > max_removed_posting_share_ * posting_count) {
+            stale_terms.push_back(term_id);
+        }
+    }
+    CompactPostingLists(policy, stale_terms);
+}
+
+template<typename ExecutionPolicy>
+void SearchServer::RenumberDocuments(const ExecutionPolicy& policy) {
+    const auto new_ordinals = DropRemovedDocuments();
+    search_execution::ParallelFor(policy, term_to_document_frequencies_.size(), [this, &new_ordinals](
+            std::size_t term_id) {
+        term_to_document_frequencies_[term_id].RenumberDocuments([&new_ordinals](DocumentOrdinal document_ordinal) {
+            return new_ordinals[document_ordinal];
+        });
+    });
+}
+
 // Parsing
 
 template<typename ExecutionPolicy>
 [[nodiscard]] SearchServer::Query SearchServer::ParseQuery(
         const ExecutionPolicy& policy, std::string_view text, WordsRepeatable words_can_be_repeated) const {
     Query query;
-    const auto words = SplitIntoWordsView(text);
+    const WordRange words(text);
     for (const auto word : words) {
-        StringHasNotAnyForbiddenChars(word);
         const auto query_word = ParseQueryWord(word);
-        if (!(query_word.is_stop)) {
-            if (query_word.is_minus) {
-                query.minus_words.push_back(query_word.content);
-            } else {
-                query.plus_words.push_back(query_word.content);
-            }
+        if (query_word.is_stop) {
+            continue;
+        }
+        const auto term_id = FindPresentTerm(query_word.content);
+        if (!term_id) {
+            continue;
+        }
+        if (query_word.is_minus) {
+            query.minus_terms.push_back(*term_id);
+        } else {
+            query.plus_terms.push_back(*term_id);
         }
     }
+    CheckNoForbiddenCharsFound(words.HasControlChars());
 
     if (static_cast<bool>(words_can_be_repeated)) {
         return query;
     }
 
-    RemoveDuplicateWords(policy, query.plus_words);
-    RemoveDuplicateWords(policy, query.minus_words);
+    RemoveDuplicateTerms(policy, query.plus_terms);
+    RemoveDuplicateTerms(policy, query.minus_terms);
 
     return query;
 }
 
+template<typename ExecutionPolicy>
+void SearchServer::RemoveDuplicateTerms(const ExecutionPolicy& policy, std::vector<TermId>& term_ids) {
+    if constexpr (std::is_execution_policy_v<ExecutionPolicy>) {
+        std::sort(policy, term_ids.begin(), term_ids.end());
+    } else {
+        std::sort(term_ids.begin(), term_ids.end());
+    }
+    auto begin_of_terms_to_remove = std::unique(term_ids.begin(), term_ids.end());
+    term_ids.erase(begin_of_terms_to_remove, term_ids.end());
+}
+
 // Search
 
 template<typename Predicate>
-[[nodiscard]] std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query,
-                                                                   Predicate predicate) const {
-    return FindTopDocuments(std::execution::seq, raw_query, predicate);
+[[nodiscard]] std::vector<Document> SearchServer::FindTopDocuments(
+        std::string_view raw_query, Predicate predicate, std::size_t result_count) const {
+    return FindTopDocuments(std::execution::seq, raw_query, predicate, result_count);
 }
 
 template<typename ExecutionPolicy, typename Predicate>
 [[nodiscard]] std::vector<Document> SearchServer::FindTopDocuments(
-        const ExecutionPolicy& policy, std::string_view raw_query, Predicate predicate) const {
-    auto result = FindAllDocuments(
+        const ExecutionPolicy& policy, std::string_view raw_query, Predicate predicate,
+        std::size_t result_count) const {
+    return FindAllDocuments(
             policy,
             ParseQuery(policy, raw_query, WordsRepeatable::No),
-            predicate);
-
-    std::sort(policy,
-              result.begin(), result.end(),
-              [](const Document& lhs, const Document& rhs) {
-                  if (std::abs(lhs.relevance - rhs.relevance) < ERROR_MARGIN) {
-                      return lhs.rating > rhs.rating;
-                  }
-                  return lhs.relevance > rhs.relevance;
-              });
-
-    if (result.size() > MAX_RESULT_DOCUMENT_COUNT) {
-        result.resize(MAX_RESULT_DOCUMENT_COUNT);
-    }
-    return result;
+            predicate,
+            result_count);
 }
 
 template<typename ExecutionPolicy>
 [[nodiscard]] std::vector<Document> SearchServer::FindTopDocuments(
-        const ExecutionPolicy& policy, std::string_view raw_query, DocumentStatus document_status) const {
-    return FindTopDocuments(
-            policy,
-            raw_query,
-            [document_status](int /*document_id*/, DocumentStatus status, int /*rating*/) {
-                return status == document_status;
-            });
+        const ExecutionPolicy& policy, std::string_view raw_query, DocumentStatus document_status,
+        std::size_t result_count) const {
+    return FindTopDocumentsByStatus(policy, ParseQuery(policy, raw_query, WordsRepeatable::No), document_status,
+                                    result_count);
 }
 
 template<typename ExecutionPolicy>
@@ -257,66 +980,459 @@ template<typename ExecutionPolicy>
 }
 
 template<typename Predicate>
-[[nodiscard]] std::vector<Document> SearchServer::FindAllDocuments(const Query& query, Predicate predicate) const {
-    std::map<int, double> doc_to_relevance;
-    ComputeDocumentsRelevance(std::execution::seq, doc_to_relevance, query, predicate);
-    return PrepareResult(doc_to_relevance);
+[[nodiscard]] std::vector<Document> SearchServer::FindTopDocuments(
+        const PreparedQuery& prepared_query, Predicate predicate, std::size_t result_count) const {
+    return FindTopDocuments(std::execution::seq, prepared_query, predicate, result_count);
+}
+
+template<typename ExecutionPolicy, typename Predicate>
+[[nodiscard]] std::vector<Document> SearchServer::FindTopDocuments(
+        const ExecutionPolicy& policy, const PreparedQuery& prepared_query, Predicate predicate,
+        std::size_t result_count) const {
+    Query query_storage;
+    return FindAllDocuments(policy, GetQuery(prepared_query, query_storage), predicate, result_count);
+}
+
+template<typename ExecutionPolicy>
+[[nodiscard]] std::vector<Document> SearchServer::FindTopDocuments(
+        const ExecutionPolicy& policy, const PreparedQuery& prepared_query, DocumentStatus document_status,
+        std::size_t result_count) const {
+    Query query_storage;
+    return FindTopDocumentsByStatus(policy, GetQuery(prepared_query, query_storage), document_status,
+                                    result_count);
+}
+
+template<typename ExecutionPolicy>
+[[nodiscard]] std::vector<Document> SearchServer::FindTopDocumentsByStatus(
+        const ExecutionPolicy& policy, const Query& query, DocumentStatus document_status,
+        std::size_t result_count) const {
+    if (!result_cache_) {
+        return FindAllDocuments(policy, query, MakeStatusFilter(document_status), result_count);
+    }
+
+    ResultCacheKey key{generation_, query.plus_terms, query.minus_terms, document_status, result_count};
+    if (auto result = result_cache_->Find(key)) {
+        return std::move(*result);
+    }
+    auto result = FindAllDocuments(policy, query, MakeStatusFilter(document_status), result_count);
+    result_cache_->Insert(std::move(key), result);
+    return result;
+}
+
+template<typename DocumentIds>
+[[nodiscard]] std::vector<SearchServer::MatchingWordsAndDocStatus> SearchServer::MatchDocuments(
+        std::string_view raw_query, const DocumentIds& document_ids) const {
+    return MatchDocuments(std::execution::seq, raw_query, document_ids);
+}
+
+template<typename ExecutionPolicy, typename DocumentIds>
+[[nodiscard]] std::vector<SearchServer::MatchingWordsAndDocStatus> SearchServer::MatchDocuments(
+        const ExecutionPolicy& policy, std::string_view raw_query, const DocumentIds& document_ids) const {
+    const auto targets = MakeMatchTargets(document_ids);
+    return MatchQueryWithDocuments(policy, ParseQuery(std::execution::seq, raw_query, WordsRepeatable::No), targets);
+}
+
+template<typename DocumentIds>
+[[nodiscard]] std::vector<SearchServer::MatchingWordsAndDocStatus> SearchServer::MatchDocuments(
+        const PreparedQuery& prepared_query, const DocumentIds& document_ids) const {
+    return MatchDocuments(std::execution::seq, prepared_query, document_ids);
+}
+
+template<typename ExecutionPolicy, typename DocumentIds>
+[[nodiscard]] std::vector<SearchServer::MatchingWordsAndDocStatus> SearchServer::MatchDocuments(
+        const ExecutionPolicy& policy, const PreparedQuery& prepared_query, const DocumentIds& document_ids) const {
+    const auto targets = MakeMatchTargets(document_ids);
+    Query query_storage;
+    return MatchQueryWithDocuments(policy, GetQuery(prepared_query, query_storage), targets);
+}
+
+template<typename DocumentIds>
+[[nodiscard]] std::vector<SearchServer::MatchTarget> SearchServer::MakeMatchTargets(
+        const DocumentIds& document_ids) const {
+    std::vector<MatchTarget> targets;
+    for (const int document_id : document_ids) {
+        CheckDocumentIdIsNotNegative(document_id);
+        CheckDocumentIdExists(document_id);
+        targets.push_back({document_id_to_ordinal_.at(document_id), targets.size()});
+    }
+    std::sort(targets.begin(), targets.end(), [](const MatchTarget& lhs, const MatchTarget& rhs) {
+        return lhs.document_ordinal < rhs.document_ordinal;
+    });
+    return targets;
+}
+
+template<typename ExecutionPolicy>
+[[nodiscard]] std::vector<SearchServer::MatchingWordsAndDocStatus> SearchServer::MatchQueryWithDocuments(
+        const ExecutionPolicy& policy, const Query& query, const std::vector<MatchTarget>& targets) const {
+    std::vector<MatchingWordsAndDocStatus> results(targets.size());
+    for (const auto& target : targets) {
+        std::get<DocumentStatus>(results[target.position]) = documents_.statuses[target.document_ordinal];
+    }
+
+    Bitmap excluded_documents_storage;
+    const Bitmap& excluded_documents = GetExcludedDocuments(query, excluded_documents_storage);
+    const auto by_ordinal = [](const MatchTarget& target, DocumentOrdinal document_ordinal) {
+        return target.document_ordinal < document_ordinal;
+    };
+
+    // Every worker intersects the postings of all plus terms with its own part of the documents.
+    // Terms are visited in the order of their words, so the words are ordered as `MatchDocument` orders them.
+    std::vector<std::pair<std::string_view, TermId>> plus_words;
+    plus_words.reserve(query.plus_terms.size());
+    for (const TermId plus_term_id : query.plus_terms) {
+        plus_words.emplace_back(term_dictionary_.GetTerm(plus_term_id), plus_term_id);
+    }
+    std::sort(plus_words.begin(), plus_words.end());
+
+    const std::size_t part_count = std::min(search_execution::GetWorkerCount(policy), targets.size());
+    search_execution::ParallelFor(
+            policy, part_count,
+            [this, &plus_words, &targets, &results, &excluded_documents, &by_ordinal, part_count](std::size_t part) {
+                const auto part_begin = targets.begin() + static_cast<std::ptrdiff_t>(
+                        targets.size() * part / part_count);
+                const auto part_end = targets.begin() + static_cast<std::ptrdiff_t>(
+                        targets.size() * (part + 1) / part_count);
+                for (const auto& [word, plus_term_id] : plus_words) {
+                    PostingList::Cursor cursor(term_to_document_frequencies_[plus_term_id]);
+                    auto target = part_begin;
+                    // Either the cursor or the target leaps to the other one, whichever is behind.
+                    while (target != part_end && !cursor.IsEnd()) {
+                        const DocumentOrdinal document_ordinal = cursor.GetDocumentId();
+                        if (target->document_ordinal < document_ordinal) {
+                            target = std::lower_bound(target, part_end, document_ordinal, by_ordinal);
+                        } else if (target->document_ordinal > document_ordinal) {
+                            cursor.SkipTo(target->document_ordinal);
+                        } else {
+                            if (!excluded_documents.Test(static_cast<std::size_t>(document_ordinal))) {
+                                for (; target != part_end && target->document_ordinal == document_ordinal; ++target) {
+                                    std::get<std::vector<std::string_view>>(results[target->position])
+                                            .push_back(word);
+                                }
+                            }
+                            cursor.Next();
+                        }
+                    }
+                }
+            });
+    return results;
+}
+
+template<typename Predicate>
+[[nodiscard]] bool SearchServer::IsAccepted(const Predicate& predicate, DocumentOrdinal document_ordinal) const {
+    if constexpr (std::is_same_v<Predicate, StatusFilter>) {
+        return predicate.documents->Test(static_cast<std::size_t>(document_ordinal));
+    } else {
+        return !documents_.tombstones.Test(static_cast<std::size_t>(document_ordinal))
+               && predicate(documents_.ids[document_ordinal],
+                           documents_.statuses[document_ordinal],
+                           documents_.ratings[document_ordinal]);
+    }
+}
+
+template<typename Predicate>
+[[nodiscard]] std::vector<Document> SearchServer::FindAllDocuments(const Query& query, Predicate predicate,
+                                                                   std::size_t result_count) const {
+    if (query.plus_terms.size() > 1 && IsPruningEfficient(query)) {
+        return FindTopDocumentsWithPruning(query, predicate, result_count);
+    }
+    const auto accumulator = ScoreAccumulator::Acquire(documents_.ids.size());
+    ComputeDocumentsRelevance(*accumulator, query, predicate);
+    return PrepareResult(*accumulator, result_count);
 }
 
 template<typename Predicate>
 [[nodiscard]] std::vector<Document> SearchServer::FindAllDocuments(
-        const std::execution::sequenced_policy&, const Query& query, Predicate predicate) const {
-    return FindAllDocuments(query, predicate);
+        const std::execution::sequenced_policy&, const Query& query, Predicate predicate,
+        std::size_t result_count) const {
+    return FindAllDocuments(query, predicate, result_count);
 }
 
 template<typename Predicate>
 [[nodiscard]] std::vector<Document> SearchServer::FindAllDocuments(
-        const std::execution::parallel_policy& par_policy, const Query& query, Predicate predicate) const {
-    ConcurrentMap<int, double> concurrent_doc_to_relevance(std::thread::hardware_concurrency());
-    ComputeDocumentsRelevance(par_policy, concurrent_doc_to_relevance, query, predicate);
-    return PrepareResult(concurrent_doc_to_relevance.BuildOrdinaryMap());
+        const std::execution::parallel_policy& par_policy, const Query& query, Predicate predicate,
+        std::size_t result_count) const {
+    return FindAllDocumentsByTerms(par_policy, query, predicate, result_count);
 }
 
-template<typename ExecutionPolicy, typename Map, typename Predicate>
-void SearchServer::ComputeDocumentsRelevance(const ExecutionPolicy& policy,
-                                             Map& document_to_relevance,
-                                             const Query& query, Predicate predicate) const {
-    static_assert(std::is_integral_v<typename Map::key_type> && std::is_floating_point_v<typename Map::mapped_type>);
+template<typename Predicate>
+[[nodiscard]] std::vector<Document> SearchServer::FindAllDocuments(
+        const search_execution::ThreadPoolPolicy& pool_policy, const Query& query, Predicate predicate,
+        std::size_t result_count) const {
+    return FindAllDocumentsByTerms(pool_policy, query, predicate, result_count);
+}
 
-    std::for_each(
-            policy,
-            query.plus_words.begin(), query.plus_words.end(),
-            [this, predicate, &document_to_relevance](auto plus_word_view) {
-                auto iter = word_to_document_frequencies_.find(plus_word_view);
-                if (iter == word_to_document_frequencies_.end()) {
-                    return;
+template<typename Predicate>
+[[nodiscard]] std::vector<Document> SearchServer::FindAllDocuments(
+        const search_execution::AdaptivePolicy& adaptive_policy, const Query& query, Predicate predicate,
+        std::size_t result_count) const {
+    switch (search_execution::ChooseQueryExecution(adaptive_policy, EstimateQueryCost(query),
+                                                   search_execution::GetWorkerCount(adaptive_policy))) {
+        case search_execution::QueryExecution::TERMS:
+            return FindAllDocumentsByTerms(search_execution::par_pool, query, predicate, result_count);
+        case search_execution::QueryExecution::DOCUMENT_RANGES:
+            return FindAllDocuments(search_execution::par_document_ranges, query, predicate, result_count);
+        default:
+            return FindAllDocuments(query, predicate, result_count);
+    }
+}
+
+template<typename ExecutionPolicy, typename Predicate>
+[[nodiscard]] std::vector<Document> SearchServer::FindAllDocumentsByTerms(
+        const ExecutionPolicy& policy, const Query& query, Predicate predicate, std::size_t result_count) const {
+    Bitmap excluded_documents_storage;
+    const Bitmap& excluded_documents = GetExcludedDocuments(query, excluded_documents_storage);
+    const std::size_t worker_count = search_execution::GetWorkerCount(policy);
+    const std::size_t document_count = documents_.ids.size();
+
+    // Every worker scores its share of the plus terms into its own accumulator,
+    // then the partial relevances are kept as lists sorted by ordinal.
+    const std::size_t term_share_count = std::min(worker_count, query.plus_terms.size());
+    std::vector<std::vector<std::pair<DocumentOrdinal, double>>> partial_relevances(term_share_count);
+    search_execution::ParallelFor(
+            policy, term_share_count,
+            [this, &query, &predicate, &excluded_documents, &partial_relevances, term_share_count, document_count](
+                    std::size_t term_share) {
+                const auto accumulator = ScoreAccumulator::Acquire(document_count);
+                // Terms are dealt round-robin, so frequent terms rarely end up in the same share.
+                for (std::size_t i = term_share; i < query.plus_terms.size(); i += term_share_count) {
+                    AccumulateTermRelevance(*accumulator, query.plus_terms[i], GetInverseDocumentFrequency(query, i),
+                                            excluded_documents, predicate);
                 }
-                const auto& document_frequencies = iter->second;
-
-                // Computation TF-IDF (term frequency–inverse document frequency)
-                // source: https://en.wikipedia.org/wiki/Tf%E2%80%93idf
-                const double idf = ComputeInverseDocumentFrequency(document_frequencies.size());
-                for (const auto& [document_id, tf] : document_frequencies) {
-                    const auto& document_data = documents_.at(document_id);
-                    if (predicate(document_id, document_data.status, document_data.rating)) {
-                        document_to_relevance[document_id] += tf * idf;
+                auto& relevances = partial_relevances[term_share];
+                relevances.reserve(accumulator->size());
+                accumulator->ForEachOrdered([&relevances](DocumentOrdinal document_ordinal, double relevance) {
+                    relevances.emplace_back(document_ordinal, relevance);
+                });
+            });
+
+    // Every worker sums up the partial relevances of its own range of ordinals.
+    return SelectTopDocumentsByRanges(
+            policy, worker_count, result_count,
+            [&partial_relevances](ScoreAccumulator& accumulator, std::size_t begin, std::size_t end) {
+                for (const auto& relevances : partial_relevances) {
+                    auto iter = std::lower_bound(relevances.begin(), relevances.end(),
+                                                 std::pair{static_cast<DocumentOrdinal>(begin), 0.0},
+                                                 [](const auto& lhs, const auto& rhs) {
+                                                     return lhs.first < rhs.first;
+                                                 });
+                    for (; iter != relevances.end() && static_cast<std::size_t>(iter->first) < end; ++iter) {
+                        accumulator[static_cast<DocumentOrdinal>(iter->first - begin)] += iter->second;
                     }
                 }
             });
+}
 
-    std::for_each(
-            policy,
-            query.minus_words.begin(), query.minus_words.end(),
-            [this, &document_to_relevance](auto minus_word_view) {
-                auto iter = word_to_document_frequencies_.find(minus_word_view);
-                if (iter == word_to_document_frequencies_.end()) {
+template<typename Predicate>
+[[nodiscard]] std::vector<Document> SearchServer::FindAllDocuments(
+        const search_execution::DocumentRangePolicy& range_policy, const Query& query, Predicate predicate,
+        std::size_t result_count) const {
+    Bitmap excluded_documents_storage;
+    const Bitmap& excluded_documents = GetExcludedDocuments(query, excluded_documents_storage);
+    std::vector<double> idfs;
+    idfs.reserve(query.plus_terms.size());
+    for (std::size_t i = 0; i < query.plus_terms.size(); ++i) {
+        idfs.push_back(GetInverseDocumentFrequency(query, i));
+    }
+
+    return SelectTopDocumentsByRanges(
+            range_policy, search_execution::GetWorkerCount(range_policy), result_count,
+            [this, &query, &predicate, &excluded_documents, &idfs](
+                    ScoreAccumulator& accumulator, std::size_t begin, std::size_t end) {
+                // Terms are visited in the query order, as the sequential scoring does.
+                for (std::size_t i = 0; i < query.plus_terms.size(); ++i) {
+                    PostingList::Cursor cursor(term_to_document_frequencies_[query.plus_terms[i]]);
+                    cursor.SkipTo(static_cast<DocumentOrdinal>(begin));
+                    for (; static_cast<std::size_t>(cursor.GetDocumentId()) < end; cursor.Next()) {
+                        const DocumentOrdinal document_ordinal = cursor.GetDocumentId();
+                        if (!excluded_documents.Test(static_cast<std::size_t>(document_ordinal))
+                            && IsAccepted(predicate, document_ordinal)) {
+                            const double tf = cursor.GetTermCount() * documents_.inverse_word_counts[document_ordinal];
+                            accumulator[static_cast<DocumentOrdinal>(document_ordinal - begin)] += tf * idfs[i];
+                        }
+                    }
+                }
+            });
+}
+
+template<typename ExecutionPolicy, typename ScoreRange>
+[[nodiscard]] std::vector<Document> SearchServer::SelectTopDocumentsByRanges(
+        const ExecutionPolicy& policy, std::size_t range_count, std::size_t result_count,
+        ScoreRange score_range) const {
+    const std::size_t document_count = documents_.ids.size();
+    const std::size_t range_size = std::max((document_count + range_count - 1) / range_count, std::size_t{1});
+    std::vector<std::vector<Document>> partial_top_documents(range_count);
+    search_execution::ParallelFor(
+            policy, range_count,
+            [this, &score_range, &partial_top_documents, range_size, document_count, result_count](
+                    std::size_t range) {
+                const std::size_t begin = range * range_size;
+                const std::size_t end = std::min(begin + range_size, document_count);
+                if (begin >= end) {
                     return;
                 }
-                const auto& document_frequencies = iter->second;
-                for (const auto [document_id, _] : document_frequencies) {
-                    document_to_relevance.erase(document_id);
+
+                const auto accumulator = ScoreAccumulator::Acquire(end - begin);
+                score_range(*accumulator, begin, end);
+                partial_top_documents[range] = SelectTopDocuments(*accumulator, static_cast<DocumentOrdinal>(begin),
+                                                                  result_count);
+            });
+    return MergeTopDocuments(partial_top_documents, result_count);
+}
+
+template<typename Map, typename Predicate>
+void SearchServer::ComputeDocumentsRelevance(Map& document_to_relevance,
+                                             const Query& query, Predicate predicate) const {
+    Bitmap excluded_documents_storage;
+    const Bitmap& excluded_documents = GetExcludedDocuments(query, excluded_documents_storage);
+    for (std::size_t i = 0; i < query.plus_terms.size(); ++i) {
+        AccumulateTermRelevance(document_to_relevance, query.plus_terms[i], GetInverseDocumentFrequency(query, i),
+                                excluded_documents, predicate);
+    }
+}
+
+template<typename Map, typename Predicate>
+void SearchServer::AccumulateTermRelevance(Map& document_to_relevance, TermId term_id, double idf,
+                                           const Bitmap& excluded_documents, const Predicate& predicate) const {
+    static_assert(std::is_integral_v<typename Map::key_type> && std::is_floating_point_v<typename Map::mapped_type>);
+
+    const auto& posting_list = term_to_document_frequencies_[term_id];
+
+    // Computation TF-IDF (term frequency–inverse document frequency)
+    // source: https://en.wikipedia.org/wiki/Tf%E2%80%93idf
+    posting_list.ForEach(
+            [this, &predicate, idf, &excluded_documents, &document_to_relevance](
+                    DocumentOrdinal document_ordinal, PostingList::TermCount term_count) {
+                if (!excluded_documents.Test(static_cast<std::size_t>(document_ordinal))
+                    && IsAccepted(predicate, document_ordinal)) {
+                    const double tf = term_count * documents_.inverse_word_counts[document_ordinal];
+                    document_to_relevance[document_ordinal] += tf * idf;
                 }
             });
 }
 
+template<typename Predicate>
+[[nodiscard]] std::vector<Document> SearchServer::FindTopDocumentsWithPruning(
+        const Query& query, Predicate predicate, std::size_t result_count) const {
+    TopK<Document, decltype(&IsMoreRelevant)> top_documents(result_count, &IsMoreRelevant);
+    if (result_count == 0) {
+        return std::move(top_documents).Release();
+    }
+
+    Bitmap excluded_documents_storage;
+    const Bitmap& excluded_documents = GetExcludedDocuments(query, excluded_documents_storage);
+
+    struct TermCursor {
+        PostingList::Cursor cursor;
+        double idf;
+        double max_score;
+        // Position of the term in the query.
+        std::size_t index;
+    };
+
+    std::vector<TermCursor> cursors;
+    cursors.reserve(query.plus_terms.size());
+    for (const TermId plus_term_id : query.plus_terms) {
+        const auto& posting_list = term_to_document_frequencies_[plus_term_id];
+        const double idf = GetInverseDocumentFrequency(query, cursors.size());
+        cursors.push_back({PostingList::Cursor(posting_list), idf, posting_list.GetMaxTermFrequency() * idf,
+                           cursors.size()});
+    }
+    std::sort(cursors.begin(), cursors.end(), [](const TermCursor& lhs, const TermCursor& rhs) {
+        return lhs.max_score < rhs.max_score;
+    });
+    // Upper bound of the relevance a document gets from the terms up to the i-th one.
+    std::vector<double> max_score_prefix_sums(cursors.size());
+    for (std::size_t i = 0; i < cursors.size(); ++i) {
+        max_score_prefix_sums[i] = (i == 0 ? 0.0 : max_score_prefix_sums[i - 1]) + cursors[i].max_score;
+    }
+
+    // Terms before the first essential one can't make a document relevant enough by themselves,
+    // so candidates are taken only from postings of the essential terms.
+    std::size_t first_essential = 0;
+    std::vector<std::pair<std::size_t, double>> term_scores;
+    term_scores.reserve(cursors.size());
+
+    while (true) {
+        // A document can replace the worst selected one only if its relevance is not less than
+        // this threshold: one error margin is for the rating tie-break of relevances,
+        // another one covers rounding errors of the summed bounds.
+        const double threshold = top_documents.IsFull()
+                                 ? top_documents.GetWorst().relevance - 2 * ERROR_MARGIN
+                                 : -std::numeric_limits<double>::infinity();
+        while (first_essential < cursors.size() && max_score_prefix_sums[first_essential] < threshold) {
+            ++first_essential;
+        }
+        if (first_essential == cursors.size()) {
+            break;
+        }
+
+        DocumentOrdinal document_ordinal = PostingList::Cursor::END_DOCUMENT_ID;
+        for (std::size_t i = first_essential; i < cursors.size(); ++i) {
+            document_ordinal = std::min(document_ordinal, cursors[i].cursor.GetDocumentId());
+        }
+        if (document_ordinal == PostingList::Cursor::END_DOCUMENT_ID) {
+            break;
+        }
+
+        const double inverse_word_count = documents_.inverse_word_counts[document_ordinal];
+        const bool is_candidate = !excluded_documents.Test(static_cast<std::size_t>(document_ordinal))
+                                  && IsAccepted(predicate, document_ordinal);
+        term_scores.clear();
+        double score = 0.0;
+        for (std::size_t i = first_essential; i < cursors.size(); ++i) {
+            auto& cursor = cursors[i].cursor;
+            if (cursor.GetDocumentId() == document_ordinal) {
+                if (is_candidate) {
+                    const double tf = cursor.GetTermCount() * inverse_word_count;
+                    term_scores.emplace_back(cursors[i].index, tf * cursors[i].idf);
+                    score += term_scores.back().second;
+                }
+                cursor.Next();
+            }
+        }
+        if (!is_candidate) {
+            continue;
+        }
+
+        if (first_essential > 0) {
+            double block_upper_bound = score;
+            for (std::size_t i = 0; i < first_essential; ++i) {
+                block_upper_bound += cursors[i].cursor.GetBlockMaxTermFrequency(document_ordinal) * cursors[i].idf;
+            }
+            if (block_upper_bound < threshold) {
+                continue;
+            }
+        }
+
+        // Non-essential terms are probed from the most valuable one while the document may still qualify.
+        bool is_pruned = false;
+        for (std::size_t i = first_essential; i-- > 0;) {
+            if (score + max_score_prefix_sums[i] < threshold) {
+                is_pruned = true;
+                break;
+            }
+            auto& cursor = cursors[i].cursor;
+            cursor.SkipTo(document_ordinal);
+            if (cursor.GetDocumentId() == document_ordinal) {
+                const double tf = cursor.GetTermCount() * inverse_word_count;
+                term_scores.emplace_back(cursors[i].index, tf * cursors[i].idf);
+                score += term_scores.back().second;
+            }
+        }
+        if (is_pruned) {
+            continue;
+        }
+
+        // Sum up in the query order, as the exhaustive scoring does, to get exactly the same relevance.
+        std::sort(term_scores.begin(), term_scores.end());
+        double relevance = 0.0;
+        for (const auto& [index, term_score] : term_scores) {
+            relevance += term_score;
+        }
+        top_documents.Push({documents_.ids[document_ordinal], relevance, documents_.ratings[document_ordinal]});
+    }
+
+    return std::move(top_documents).Release();
+}
+
 // The end of Search Server template implementation
\ No newline at end of file
@@ -0,0 +1,106 @@
+#include "set_intersection.h"
+
+#include <algorithm>
+#include <utility>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace set_intersection {
+
+namespace {
+
+// If the larger set is this many times larger, its elements are galloped over
+// instead of being compared with every element of the smaller set.
+constexpr std::size_t GALLOPING_SIZE_RATIO = 32;
+
+// Returns the first position of `values` in [`first`, `size`) whose value is not less than `value`.
+std::size_t Gallop(const std::uint32_t* values, std::size_t first, std::size_t size, std::uint32_t value) noexcept {
+    std::size_t step = 1;
+    std::size_t last = first;
+    while (last < size && values[last] < value) {
+        first = last + 1;
+        last += step;
+        step *= 2;
+    }
+    return static_cast<std::size_t>(std::lower_bound(values + first, values + std::min(last, size), value) - values);
+}
+
+// Calls `on_common(value)` for every common element until it returns false.
+template<typename OnCommon>
+void ForEachCommon(const std::uint32_t* small, std::size_t small_size,
+                   const std::uint32_t* large, std::size_t large_size,
+                   OnCommon on_common) noexcept {
+    std::size_t j = 0;
+    if (large_size / GALLOPING_SIZE_RATIO >= small_size) {
+        for (std::size_t i = 0; i < small_size && j < large_size; ++i) {
+            j = Gallop(large, j, large_size, small[i]);
+            if (j < large_size && large[j] == small[i] && !on_common(small[i])) {
+                return;
+            }
+        }
+        return;
+    }
+
+    for (std::size_t i = 0; i < small_size; ++i) {
+        const std::uint32_t value = small[i];
+#ifdef __SSE2__
+        // The window of four elements moves on while all of them are less than the value,
+        // then the value is compared with the whole window at once.
+        while (j + 4 <= large_size && large[j + 3] < value) {
+            j += 4;
+        }
+        if (j + 4 <= large_size) {
+            const __m128i window = _mm_loadu_si128(reinterpret_cast<const __m128i*>(large + j));
+            const __m128i equal = _mm_cmpeq_epi32(window, _mm_set1_epi32(static_cast<int>(value)));
+            if (_mm_movemask_epi8(equal) != 0 && !on_common(value)) {
+                return;
+            }
+            continue;
+        }
+#endif
+        while (j < large_size && large[j] < value) {
+            ++j;
+        }
+        if (j == large_size) {
+            return;
+        }
+        if (large[j] == value && !on_common(value)) {
+            return;
+        }
+    }
+}
+
+} // namespace
+
+std::size_t Intersect(const std::uint32_t* lhs, std::size_t lhs_size,
+                      const std::uint32_t* rhs, std::size_t rhs_size,
+                      std::uint32_t* out) noexcept {
+    if (lhs_size > rhs_size) {
+        std::swap(lhs, rhs);
+        std::swap(lhs_size, rhs_size);
+    }
+    std::size_t count = 0;
+    ForEachCommon(lhs, lhs_size, rhs, rhs_size, [out, &count](std::uint32_t value) {
+        out[count++] = value;
+        return true;
+    });
+    return count;
+}
+
+[[nodiscard]] bool Intersects(const std::uint32_t* lhs, std::size_t lhs_size,
+                              const std::uint32_t* rhs, std::size_t rhs_size) noexcept {
+    if (lhs_size > rhs_size) {
+        std::swap(lhs, rhs);
+        std::swap(lhs_size, rhs_size);
+    }
+    bool is_found = false;
+    ForEachCommon(lhs, lhs_size, rhs, rhs_size, [&is_found](std::uint32_t) {
+        is_found = true;
+        return false;
+    });
+    return is_found;
+}
+
+} // namespace set_intersection
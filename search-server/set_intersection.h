@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/// Intersection of sorted sets of unsigned 32-bit integers, such as term ids of a query and of a document.
+namespace set_intersection {
+
+/// Writes the common elements of sorted sets `lhs` and `rhs` to `out` in ascending order
+/// and returns their number; `out` must have room for the smaller set.
+std::size_t Intersect(const std::uint32_t* lhs, std::size_t lhs_size,
+                      const std::uint32_t* rhs, std::size_t rhs_size,
+                      std::uint32_t* out) noexcept;
+
+/// Tells whether sorted sets `lhs` and `rhs` have a common element.
+[[nodiscard]] bool Intersects(const std::uint32_t* lhs, std::size_t lhs_size,
+                              const std::uint32_t* rhs, std::size_t rhs_size) noexcept;
+
+} // namespace set_intersection
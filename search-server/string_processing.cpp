@@ -1,40 +1,136 @@
 #include "string_processing.h"
 
-std::vector<std::string> SplitIntoWords(std::string_view text) {
-    std::vector<std::string> words;
-    std::string word;
-    for (const char c : text) {
-        if (c == ' ') {
-            if (!word.empty()) {
-                words.push_back(std::move(word));
-                word.clear();
-            }
-        } else {
-            word += c;
+#include <algorithm>
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+constexpr char SEPARATOR = ' ';
+
+[[nodiscard]] constexpr bool IsControlChar(char c) noexcept {
+    const auto byte = static_cast<unsigned char>(c);
+    return byte < 0x20 || byte == 0x7F;
+}
+
+#if defined(__AVX2__) || defined(__SSE2__)
+
+#ifdef __AVX2__
+constexpr std::size_t CHUNK_SIZE = 32;
+#else
+constexpr std::size_t CHUNK_SIZE = 16;
+#endif
+
+// Bit `i` of the masks tells whether byte `i` of the chunk is a separator or a control character.
+struct ChunkMasks {
+    std::uint64_t separators;
+    std::uint64_t control_chars;
+};
+
+[[nodiscard]] ChunkMasks LoadChunkMasks(const char* chunk) noexcept {
+#ifdef __AVX2__
+    const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(chunk));
+    const __m256i separators = _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(SEPARATOR));
+    // Unsigned `byte <= 0x1F` is `max(byte, 0x1F) == 0x1F`.
+    const __m256i low_bytes = _mm256_cmpeq_epi8(_mm256_max_epu8(bytes, _mm256_set1_epi8(0x1F)),
+                                                _mm256_set1_epi8(0x1F));
+    const __m256i control_chars = _mm256_or_si256(low_bytes, _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(0x7F)));
+    return {static_cast<std::uint32_t>(_mm256_movemask_epi8(separators)),
+            static_cast<std::uint32_t>(_mm256_movemask_epi8(control_chars))};
+#else
+    const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(chunk));
+    const __m128i separators = _mm_cmpeq_epi8(bytes, _mm_set1_epi8(SEPARATOR));
+    // Unsigned `byte <= 0x1F` is `max(byte, 0x1F) == 0x1F`.
+    const __m128i low_bytes = _mm_cmpeq_epi8(_mm_max_epu8(bytes, _mm_set1_epi8(0x1F)), _mm_set1_epi8(0x1F));
+    const __m128i control_chars = _mm_or_si128(low_bytes, _mm_cmpeq_epi8(bytes, _mm_set1_epi8(0x7F)));
+    return {static_cast<std::uint32_t>(_mm_movemask_epi8(separators)),
+            static_cast<std::uint32_t>(_mm_movemask_epi8(control_chars))};
+#endif
+}
+
+[[nodiscard]] int CountTrailingZeros(std::uint64_t bits) noexcept {
+    return __builtin_ctzll(bits);
+}
+
+#endif
+
+// Returns the first position in [`pos`, `size`) whose byte is (not) a separator, or `size` if there is none.
+// Looking for the end of a word, control characters of the word are reported by `control_char_found`.
+template<bool IsSeparator>
+[[nodiscard]] std::size_t FindFirst(const char* data, std::size_t pos, std::size_t size,
+                                    bool& control_char_found) noexcept {
+#if defined(__AVX2__) || defined(__SSE2__)
+    constexpr std::uint64_t CHUNK_BITS = (std::uint64_t(1) << CHUNK_SIZE) - 1;
+    for (; pos + CHUNK_SIZE <= size; pos += CHUNK_SIZE) {
+        const auto [separators, control_chars] = LoadChunkMasks(data + pos);
+        const std::uint64_t matches = IsSeparator ? separators : ~separators & CHUNK_BITS;
+        if (matches == 0) {
+            control_char_found = control_char_found || (IsSeparator && control_chars != 0);
+            continue;
         }
+        const int offset = CountTrailingZeros(matches);
+        if constexpr (IsSeparator) {
+            control_char_found = control_char_found || (control_chars & ((std::uint64_t(1) << offset) - 1)) != 0;
+        }
+        return pos + offset;
     }
-    if (!word.empty()) {
-        words.push_back(std::move(word));
+#endif
+    for (; pos < size; ++pos) {
+        if ((data[pos] == SEPARATOR) == IsSeparator) {
+            return pos;
+        }
+        if constexpr (IsSeparator) {
+            control_char_found = control_char_found || IsControlChar(data[pos]);
+        }
     }
-
-    return words;
+    return size;
 }
 
-std::vector<std::string_view> SplitIntoWordsView(std::string_view text) {
-    using pos_t = std::size_t;
-    using count_t = std::size_t;
-
-    std::vector<std::string_view> words;
+} // namespace
 
-    pos_t pos = text.find_first_not_of(' ');
-    text.remove_prefix(pos == std::string_view::npos ? text.size() : count_t(pos));
+void WordRange::Iterator::FindWord(const char* from) noexcept {
+    const char* const data = range_->text_.data();
+    const std::size_t size = range_->text_.size();
+    bool& control_char_found = range_->has_control_chars_;
+    const std::size_t word_begin = FindFirst<false>(data, static_cast<std::size_t>(from - data), size,
+                                                    control_char_found);
+    const std::size_t word_end = FindFirst<true>(data, word_begin, size, control_char_found);
+    word_ = std::string_view(data + word_begin, word_end - word_begin);
+}
 
-    while (!text.empty()) {
-        pos_t pos_space = text.find(' ');
-        words.push_back(text.substr(pos_t(0), count_t(pos_space)));
-        pos = text.find_first_not_of(' ', pos_space);
-        text.remove_prefix(pos == std::string_view::npos ? text.size() : count_t(pos));
+std::vector<std::string> SplitIntoWords(std::string_view text) {
+    std::vector<std::string> words;
+    for (const auto word : WordRange(text)) {
+        words.emplace_back(word);
     }
+    return words;
+}
 
+std::vector<std::string_view> SplitIntoWordsView(std::string_view text, bool* has_control_chars) {
+    const WordRange range(text);
+    std::vector<std::string_view> words;
+    for (const auto word : range) {
+        words.push_back(word);
+    }
+    if (has_control_chars != nullptr) {
+        *has_control_chars = range.HasControlChars();
+    }
     return words;
-}
\ No newline at end of file
+}
+
+[[nodiscard]] bool HasControlChars(std::string_view text) noexcept {
+    std::size_t pos = 0;
+#if defined(__AVX2__) || defined(__SSE2__)
+    for (; pos + CHUNK_SIZE <= text.size(); pos += CHUNK_SIZE) {
+        if (LoadChunkMasks(text.data() + pos).control_chars != 0) {
+            return true;
+        }
+    }
+#endif
+    return std::any_of(text.begin() + pos, text.end(), IsControlChar);
+}
@@ -1,19 +1,95 @@
 #pragma once
 
-#include <algorithm>
+#include <iterator>
 #include <string>
 #include <string_view>
 #include <vector>
+#include <cstddef>
 
-std::vector<std::string> SplitIntoWords(std::string_view text);
+/// Lazy forward range of the words of a text separated by spaces. Words are found on demand
+/// by a vectorized scan and refer to the text, so iterating allocates nothing.
+/// The scan also looks for control characters (0x00-0x1F and 0x7F) in the words:
+/// `HasControlChars` tells whether the words reached by the iterators so far have some.
+class WordRange {
+public:
+    class Iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::string_view;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const std::string_view*;
+        using reference = const std::string_view&;
+
+        Iterator() = default;
+
+        [[nodiscard]] reference operator*() const noexcept {
+            return word_;
+        }
+
+        [[nodiscard]] pointer operator->() const noexcept {
+            return &word_;
+        }
+
+        Iterator& operator++() noexcept {
+            FindWord(word_.data() + word_.size());
+            return *this;
+        }
+
+        Iterator operator++(int) noexcept {
+            auto copy = *this;
+            ++*this;
+            return copy;
+        }
+
+        [[nodiscard]] bool operator==(const Iterator& other) const noexcept {
+            return word_.data() == other.word_.data();
+        }
+
+        [[nodiscard]] bool operator!=(const Iterator& other) const noexcept {
+            return !(*this == other);
+        }
+
+    private:
+        friend WordRange;
 
-std::vector<std::string_view> SplitIntoWordsView(std::string_view text);
+        const WordRange* range_ = nullptr;
+        // The past-the-end iterator holds an empty word at the end of the text.
+        std::string_view word_;
+
+        Iterator(const WordRange* range, const char* word_end) noexcept
+                : range_(range), word_(word_end, 0) {
+        }
+
+        void FindWord(const char* from) noexcept;
+    };
+
+    explicit WordRange(std::string_view text) noexcept
+            : text_(text) {
+    }
+
+    [[nodiscard]] Iterator begin() const noexcept {
+        Iterator iter(this, text_.data());
+        iter.FindWord(text_.data());
+        return iter;
+    }
+
+    [[nodiscard]] Iterator end() const noexcept {
+        return Iterator(this, text_.data() + text_.size());
+    }
+
+    [[nodiscard]] bool HasControlChars() const noexcept {
+        return has_control_chars_;
+    }
+
+private:
+    std::string_view text_;
+    mutable bool has_control_chars_ = false;
+};
+
+std::vector<std::string> SplitIntoWords(std::string_view text);
 
-template<typename ExecutionPolicy, typename ContiguousContainer>
-void RemoveDuplicateWords(const ExecutionPolicy& policy, ContiguousContainer& container) {
-    static_assert(std::is_convertible_v<typename ContiguousContainer::value_type, std::string_view>);
+/// Collects the words of `WordRange`: `*has_control_chars` tells whether there are control characters.
+std::vector<std::string_view> SplitIntoWordsView(std::string_view text, bool* has_control_chars = nullptr);
 
-    std::sort(policy, container.begin(), container.end());
-    auto begin_of_words_to_remove = std::unique(container.begin(), container.end());
-    container.erase(begin_of_words_to_remove, container.end());
-}
\ No newline at end of file
+/// Tells whether the text has control characters (0x00-0x1F and 0x7F).
+[[nodiscard]] bool HasControlChars(std::string_view text) noexcept;
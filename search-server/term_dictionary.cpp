@@ -0,0 +1,115 @@
+#include "term_dictionary.h"
+
+#include <stdexcept>
+
+TermDictionary::TermDictionary(const TermDictionary& other)
+        : terms_(other.terms_)
+        , free_ids_(other.free_ids_) {
+    (void) IndexTerms();
+}
+
+TermDictionary& TermDictionary::operator=(const TermDictionary& other) {
+    if (this != &other) {
+        terms_ = other.terms_;
+        free_ids_ = other.free_ids_;
+        (void) IndexTerms();
+    }
+    return *this;
+}
+
+// Capacity
+
+[[nodiscard]] std::size_t TermDictionary::size() const noexcept {
+    return term_to_id_.size();
+}
+
+[[nodiscard]] std::size_t TermDictionary::GetIdBound() const noexcept {
+    return terms_.size();
+}
+
+// Lookup
+
+[[nodiscard]] std::optional<TermDictionary::TermId> TermDictionary::Find(std::string_view term) const {
+    if (auto iter = term_to_id_.find(term); iter != term_to_id_.end()) {
+        return iter->second;
+    }
+    return std::nullopt;
+}
+
+[[nodiscard]] std::string_view TermDictionary::GetTerm(TermId term_id) const {
+    return terms_[term_id];
+}
+
+// Modification
+
+TermDictionary::TermId TermDictionary::Intern(std::string_view term) {
+    if (auto iter = term_to_id_.find(term); iter != term_to_id_.end()) {
+        return iter->second;
+    }
+
+    TermId term_id;
+    if (free_ids_.empty()) {
+        term_id = static_cast<TermId>(terms_.size());
+        terms_.emplace_back(term);
+    } else {
+        term_id = free_ids_.back();
+        free_ids_.pop_back();
+        terms_[term_id] = std::string(term);
+    }
+    term_to_id_.emplace(terms_[term_id], term_id);
+    return term_id;
+}
+
+void TermDictionary::Release(TermId term_id) {
+    auto& term = terms_[term_id];
+    term_to_id_.erase(term);
+    term.clear();
+    term.shrink_to_fit();
+    free_ids_.push_back(term_id);
+}
+
+// Serialization
+
+void TermDictionary::Write(index_file::IndexWriter& writer) const {
+    // Released terms are empty strings, which aren't words.
+    writer.WriteStrings(terms_);
+    writer.WriteArray(free_ids_);
+}
+
+[[nodiscard]] TermDictionary TermDictionary::Read(index_file::IndexReader& reader) {
+    using namespace std::string_literals;
+
+    TermDictionary dictionary;
+    for (auto& term : reader.ReadStrings()) {
+        dictionary.terms_.push_back(std::move(term));
+    }
+    dictionary.free_ids_ = reader.ReadArray<TermId>();
+    if (!dictionary.IndexTerms()) {
+        throw std::invalid_argument("Index file has a repeated term"s);
+    }
+    // Every released term must be free exactly once, otherwise `Intern` would overwrite a live term.
+    std::vector<bool> is_free(dictionary.terms_.size(), false);
+    for (const TermId term_id : dictionary.free_ids_) {
+        if (term_id >= dictionary.terms_.size() || is_free[term_id] || !dictionary.terms_[term_id].empty()) {
+            throw std::invalid_argument("Index file has inconsistent term ids"s);
+        }
+        is_free[term_id] = true;
+    }
+    if (dictionary.term_to_id_.size() + dictionary.free_ids_.size() != dictionary.terms_.size()) {
+        throw std::invalid_argument("Index file has inconsistent term ids"s);
+    }
+    return dictionary;
+}
+
+bool TermDictionary::IndexTerms() {
+    term_to_id_.clear();
+    term_to_id_.reserve(terms_.size());
+    for (std::size_t term_id = 0; term_id < terms_.size(); ++term_id) {
+        const auto& term = terms_[term_id];
+        // Released terms are empty strings.
+        if (!term.empty() && !term_to_id_.emplace(term, static_cast<TermId>(term_id)).second) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "index_file.h"
+
+#include <deque>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+
+/// Interns words and assigns them dense 32-bit term ids,
+/// so that indices can be keyed by integers instead of strings.
+///
+/// The dictionary owns the only copy of every term. Term strings never move in memory,
+/// so `std::string_view` returned by `GetTerm` is valid until the term is released.
+/// Ids of released terms are reused by the following `Intern` calls.
+class TermDictionary {
+public:
+    using TermId = std::uint32_t;
+
+    TermDictionary() = default;
+
+    /// The copy looks terms up among its own strings, so it doesn't depend on the original.
+    TermDictionary(const TermDictionary& other);
+    TermDictionary& operator=(const TermDictionary& other);
+
+    // Moving a deque keeps its strings in place, so the keys stay valid.
+    TermDictionary(TermDictionary&&) noexcept = default;
+    TermDictionary& operator=(TermDictionary&&) noexcept = default;
+
+    // Capacity
+
+    /// Returns the number of interned terms.
+    [[nodiscard]] std::size_t size() const noexcept;
+
+    /// Returns the upper bound of all issued term ids;
+    /// it is suitable as a size of arrays indexed by term id.
+    [[nodiscard]] std::size_t GetIdBound() const noexcept;
+
+    // Lookup
+
+    [[nodiscard]] std::optional<TermId> Find(std::string_view term) const;
+
+    [[nodiscard]] std::string_view GetTerm(TermId term_id) const;
+
+    // Modification
+
+    /// Returns the id of the term, allocating a copy of the term only if it is new.
+    TermId Intern(std::string_view term);
+
+    void Release(TermId term_id);
+
+    // Serialization
+
+    /// Writes the terms with their ids, including the ids of released terms.
+    void Write(index_file::IndexWriter& writer) const;
+
+    [[nodiscard]] static TermDictionary Read(index_file::IndexReader& reader);
+
+private:
+    std::deque<std::string> terms_;
+    // Keys refer to the strings of `terms_`.
+    std::unordered_map<std::string_view, TermId> term_to_id_;
+    std::vector<TermId> free_ids_;
+
+    /// Rebuilds `term_to_id_` over the strings of `terms_`, skipping released terms.
+    /// Returns false if some term is repeated.
+    bool IndexTerms();
+};
\ No newline at end of file
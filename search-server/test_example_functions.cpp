@@ -27,7 +27,7 @@ std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const Se
     return server.MatchDocument(raw_query, document_id);
 }
 
-const std::map<std::string_view, double>& GetWordFrequencies(const SearchServer& server, int document_id) {
+std::map<std::string_view, double> GetWordFrequencies(const SearchServer& server, int document_id) {
     LOG_DURATION(__FUNCTION__ + " operation time"s);
     return server.GetWordFrequencies(document_id);
 }
@@ -18,6 +18,6 @@ std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const Se
                                                                         std::string_view raw_query,
                                                                         int document_id);
 
-const std::map<std::string_view, double>& GetWordFrequencies(const SearchServer& server, int document_id);
+std::map<std::string_view, double> GetWordFrequencies(const SearchServer& server, int document_id);
 
 void RemoveDuplicatesWithProfiling(SearchServer& server);
\ No newline at end of file
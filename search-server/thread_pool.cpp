@@ -0,0 +1,102 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(std::size_t thread_count) {
+    queues_.reserve(thread_count);
+    for (std::size_t i = 0; i < thread_count; ++i) {
+        queues_.push_back(std::make_unique<TaskQueue>());
+    }
+    threads_.reserve(thread_count);
+    for (std::size_t i = 0; i < thread_count; ++i) {
+        threads_.emplace_back([this, i] {
+            RunWorker(i);
+        });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard guard(sleep_mutex_);
+        is_stopping_ = true;
+    }
+    wake_up_.notify_all();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+}
+
+[[nodiscard]] ThreadPool& ThreadPool::GetDefault() {
+    static ThreadPool pool(std::max(std::thread::hardware_concurrency(), 1u) - 1);
+    return pool;
+}
+
+// Capacity
+
+[[nodiscard]] std::size_t ThreadPool::GetThreadCount() const noexcept {
+    return threads_.size();
+}
+
+// Execution
+
+void ThreadPool::Submit(Task task) {
+    const std::size_t queue_index = current_pool_ == this
+                                    ? current_worker_index_
+                                    : next_queue_index_++ % queues_.size();
+    {
+        auto& queue = *queues_[queue_index];
+        std::lock_guard guard(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+    }
+    {
+        std::lock_guard guard(sleep_mutex_);
+        ++queued_task_count_;
+    }
+    wake_up_.notify_one();
+}
+
+[[nodiscard]] bool ThreadPool::TryRunTask(std::size_t worker_index) {
+    Task task;
+    for (std::size_t i = 0; i < queues_.size() && !task; ++i) {
+        auto& queue = *queues_[(worker_index + i) % queues_.size()];
+        std::lock_guard guard(queue.mutex);
+        if (queue.tasks.empty()) {
+            continue;
+        }
+        // The own newest task is likely hot in cache, a stolen oldest one is likely the largest.
+        if (i == 0) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        } else {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+    }
+    if (!task) {
+        return false;
+    }
+
+    {
+        std::lock_guard guard(sleep_mutex_);
+        --queued_task_count_;
+    }
+    task();
+    return true;
+}
+
+void ThreadPool::RunWorker(std::size_t worker_index) {
+    current_pool_ = this;
+    current_worker_index_ = worker_index;
+    while (true) {
+        if (TryRunTask(worker_index)) {
+            continue;
+        }
+        std::unique_lock lock(sleep_mutex_);
+        wake_up_.wait(lock, [this] {
+            return is_stopping_ || queued_task_count_ > 0;
+        });
+        if (is_stopping_ && queued_task_count_ == 0) {
+            return;
+        }
+    }
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <cstddef>
+
+/// Fixed set of threads executing tasks with work stealing.
+///
+/// Every worker has its own task deque: a worker takes the newest task of its own deque
+/// and, when the deque is empty, steals the oldest task of another worker. Tasks submitted
+/// by a worker go to its own deque, tasks submitted by other threads are distributed round-robin.
+class ThreadPool {
+public:
+    explicit ThreadPool(std::size_t thread_count);
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /// Waits for the submitted tasks to be done.
+    ~ThreadPool();
+
+    /// Returns the process-wide pool. It is created on the first call with one thread
+    /// less than the hardware concurrency, since the threads calling `ParallelFor` take part in the work;
+    /// on a single core the pool has no threads and `ParallelFor` runs on the calling thread.
+    [[nodiscard]] static ThreadPool& GetDefault();
+
+    // Capacity
+
+    [[nodiscard]] std::size_t GetThreadCount() const noexcept;
+
+    // Execution
+
+    /// Calls `func(index)` for every index in [0, `count`) and returns when all calls are done.
+    /// The calling thread executes calls too, so a nested call from a task of the pool never deadlocks.
+    /// If some calls throw, the first exception is rethrown after all calls are done.
+    template<typename Func>
+    void ParallelFor(std::size_t count, Func&& func);
+
+private:
+    using Task = std::function<void()>;
+
+    struct TaskQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<TaskQueue>> queues_;
+    std::vector<std::thread> threads_;
+    std::atomic<std::size_t> next_queue_index_ = 0;
+
+    std::mutex sleep_mutex_;
+    std::condition_variable wake_up_;
+    std::size_t queued_task_count_ = 0;
+    bool is_stopping_ = false;
+
+    inline static thread_local const ThreadPool* current_pool_ = nullptr;
+    inline static thread_local std::size_t current_worker_index_ = 0;
+
+    void Submit(Task task);
+
+    [[nodiscard]] bool TryRunTask(std::size_t worker_index);
+
+    void RunWorker(std::size_t worker_index);
+};
+
+// ThreadPool template implementation
+
+template<typename Func>
+void ThreadPool::ParallelFor(std::size_t count, Func&& func) {
+    if (count == 0) {
+        return;
+    }
+    if (count == 1 || threads_.empty()) {
+        for (std::size_t index = 0; index < count; ++index) {
+            func(index);
+        }
+        return;
+    }
+
+    struct Job {
+        std::atomic<std::size_t> next_index = 0;
+        std::atomic<std::size_t> done_count = 0;
+        std::mutex mutex;
+        std::condition_variable done;
+        std::exception_ptr exception;
+    };
+
+    // Helpers that start after all indices are taken don't touch `func`,
+    // so the job outlives the call only as a shared state.
+    auto job = std::make_shared<Job>();
+    auto run = [job, count, &func] {
+        for (std::size_t index = job->next_index++; index < count; index = job->next_index++) {
+            try {
+                func(index);
+            } catch (...) {
+                std::lock_guard guard(job->mutex);
+                if (!job->exception) {
+                    job->exception = std::current_exception();
+                }
+            }
+            if (++job->done_count == count) {
+                std::lock_guard guard(job->mutex);
+                job->done.notify_all();
+            }
+        }
+    };
+
+    const std::size_t helper_count = std::min(count - 1, threads_.size());
+    for (std::size_t i = 0; i < helper_count; ++i) {
+        Submit(run);
+    }
+    run();
+
+    std::unique_lock lock(job->mutex);
+    job->done.wait(lock, [&job, count] {
+        return job->done_count == count;
+    });
+    if (job->exception) {
+        std::rethrow_exception(job->exception);
+    }
+}
+
+// The end of ThreadPool template implementation
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include <cstddef>
+
+/// Selects the `k` best elements of a stream, where `is_better(lhs, rhs)` tells
+/// whether `lhs` must precede `rhs` in the result.
+///
+/// At most `k` elements are kept in a heap with the worst of them at the top,
+/// so selecting from `n` elements costs O(n log k) time and O(k) memory.
+template<typename T, typename IsBetter>
+class TopK {
+public:
+    TopK(std::size_t k, IsBetter is_better)
+            : k_(k)
+            , is_better_(std::move(is_better)) {
+    }
+
+    [[nodiscard]] std::size_t size() const noexcept {
+        return heap_.size();
+    }
+
+    [[nodiscard]] bool IsFull() const noexcept {
+        return heap_.size() == k_;
+    }
+
+    /// Returns the element that the next pushed element has to beat once the selection is full.
+    [[nodiscard]] const T& GetWorst() const {
+        return heap_.front();
+    }
+
+    void Push(T value) {
+        if (heap_.size() < k_) {
+            heap_.push_back(std::move(value));
+            std::push_heap(heap_.begin(), heap_.end(), is_better_);
+        } else if (k_ > 0 && is_better_(value, heap_.front())) {
+            std::pop_heap(heap_.begin(), heap_.end(), is_better_);
+            heap_.back() = std::move(value);
+            std::push_heap(heap_.begin(), heap_.end(), is_better_);
+        }
+    }
+
+    /// Returns the selected elements, the best one first.
+    [[nodiscard]] std::vector<T> Release() && {
+        std::sort_heap(heap_.begin(), heap_.end(), is_better_);
+        return std::move(heap_);
+    }
+
+private:
+    std::size_t k_;
+    IsBetter is_better_;
+    std::vector<T> heap_;
+};
\ No newline at end of file
@@ -5,9 +5,23 @@
 #include "search_server.h"
 #include "paginator.h"
 #include "flatten_container.h"
+#include "posting_list.h"
+#include "term_dictionary.h"
+#include "bitmap.h"
+#include "top_k.h"
+#include "score_accumulator.h"
+#include "thread_pool.h"
+#include "lru_cache.h"
+#include "process_queries.h"
+#include "set_intersection.h"
+#include "write_ahead_log.h"
+#include "string_processing.h"
 
+#include <filesystem>
 #include <forward_list>
+#include <fstream>
 #include <list>
+#include <memory>
 
 namespace unit_tests {
 
@@ -72,6 +86,62 @@ inline void TestAddDocument() {
     }
 }
 
+inline void TestAddDocuments() {
+    const std::vector<std::string> texts = {"cat in the city"s, "dog in the town"s, "funny cat"s,
+                                            "cat dog parrot"s, "big city lights"s, "town of cats"s, "dog"s};
+    std::vector<DocumentToAdd> documents;
+    SearchServer expected_server("in the"sv);
+    for (std::size_t i = 0; i < texts.size(); ++i) {
+        const int id = static_cast<int>(i) * 2;
+        const auto status = i % 3 == 0 ? DocumentStatus::ACTUAL : DocumentStatus::BANNED;
+        const std::vector<int> ratings = {static_cast<int>(i), 1};
+        documents.push_back({id, texts[i], status, ratings});
+        expected_server.AddDocument(id, texts[i], status, ratings);
+    }
+
+    const auto test_batch = [&](const auto& policy, std::size_t checkpoint_document_count) {
+        SearchServer server("in the"sv);
+        server.AddDocument(100, "cat city"sv, DocumentStatus::ACTUAL, {5});
+        server.AddDocuments(policy, documents, checkpoint_document_count);
+        ASSERT_EQUAL(server.GetDocumentCount(), expected_server.GetDocumentCount() + 1);
+        for (const int id : expected_server) {
+            ASSERT_EQUAL(server.GetWordFrequencies(id), expected_server.GetWordFrequencies(id));
+            ASSERT(server.MatchDocument("cat city dog"sv, id) == expected_server.MatchDocument("cat city dog"sv, id));
+        }
+        const auto [words, status] = server.MatchDocument("cat city"sv, 100);
+        ASSERT_EQUAL(words.size(), 2u);
+        for (const auto status : {DocumentStatus::ACTUAL, DocumentStatus::BANNED}) {
+            ASSERT_EQUAL(server.FindTopDocuments("dog town"sv, status).size(),
+                         expected_server.FindTopDocuments("dog town"sv, status).size());
+        }
+    };
+    for (const std::size_t checkpoint_document_count : {0u, 1u, 3u, 100u}) {
+        test_batch(std::execution::seq, checkpoint_document_count);
+        test_batch(std::execution::par, checkpoint_document_count);
+        test_batch(search_execution::par_pool, checkpoint_document_count);
+        // More partial indexes than documents in a checkpoint, and more than terms.
+        test_batch(search_execution::DocumentRangePolicy{5}, checkpoint_document_count);
+        test_batch(search_execution::DocumentRangePolicy{64}, checkpoint_document_count);
+    }
+
+    // The documents before the first invalid one are added, as if `AddDocument` were called one by one.
+    for (const auto& invalid_document : {DocumentToAdd{-1, "cat"sv, DocumentStatus::ACTUAL, {}},
+                                         DocumentToAdd{2, "cat"sv, DocumentStatus::ACTUAL, {}},
+                                         DocumentToAdd{3, "ca\x12t"sv, DocumentStatus::ACTUAL, {}}}) {
+        auto batch = documents;
+        batch.insert(batch.begin() + 3, invalid_document);
+        SearchServer server(""sv);
+        ASSERT_THROW(server.AddDocuments(search_execution::par_pool, batch, 2), std::invalid_argument);
+        ASSERT_EQUAL(server.GetDocumentCount(), 3);
+        ASSERT(server.FindTopDocuments("parrot"sv).empty());
+        // The valid document of the interrupted checkpoint has its postings too.
+        ASSERT_EQUAL(server.FindTopDocuments("funny"sv, DocumentStatus::BANNED).size(), 1u);
+    }
+    SearchServer server(""sv);
+    server.AddDocuments({});
+    ASSERT_EQUAL(server.GetDocumentCount(), 0);
+}
+
 inline void TestRemoveDocument() {
     SearchServer server("and in with"sv);
     {
@@ -100,6 +170,199 @@ inline void TestRemoveDocument() {
         std::vector<int> answer = {0, 5, 10, 100};
         ASSERT_EQUAL(res, answer);
     }
+    {
+        server.RemoveDocument(std::execution::par, 5);
+        server.RemoveDocument(search_execution::par_pool, 100);
+        std::vector<int> res(server.begin(), server.end());
+        std::sort(res.begin(), res.end());
+        std::vector<int> answer = {0, 10};
+        ASSERT_EQUAL(res, answer);
+        ASSERT(server.FindTopDocuments("kitty"sv).empty());
+        ASSERT_EQUAL(server.FindTopDocuments("blue"sv).size(), 1u);
+    }
+}
+
+inline void TestCopySearchServer() {
+    auto original = std::make_unique<SearchServer>("and in with"sv);
+    original->AddDocument(1, "white cat"sv, DocumentStatus::ACTUAL, {1});
+    original->AddDocument(2, "black dog"sv, DocumentStatus::ACTUAL, {2});
+    const SearchServer copy = *original;
+    SearchServer assigned(""sv);
+    assigned = *original;
+
+    // Removing the only document with a word releases the word in the original.
+    original->SetCompactionThresholds(0.0, 1.0);
+    original->RemoveDocument(2);
+    ASSERT(original->FindTopDocuments("dog"sv).empty());
+    original.reset();
+
+    for (const SearchServer* server : {&copy, static_cast<const SearchServer*>(&assigned)}) {
+        ASSERT_EQUAL(server->GetDocumentCount(), 2);
+        const auto found_docs = server->FindTopDocuments("black dog"sv);
+        ASSERT_EQUAL(found_docs.size(), 1u);
+        ASSERT_EQUAL(found_docs[0].id, 2);
+        ASSERT_EQUAL(std::get<0>(server->MatchDocument("white cat"sv, 1)).size(), 2u);
+    }
+}
+
+inline void TestReAddRemovedDocument() {
+    SearchServer server("and in with"sv);
+    server.AddDocument(10, "white cat"sv, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(3, "black cat"sv, DocumentStatus::ACTUAL, {2});
+    server.AddDocument(7, "blue cat"sv, DocumentStatus::ACTUAL, {3});
+    server.RemoveDocument(3);
+    server.AddDocument(3, "black dog"sv, DocumentStatus::BANNED, {4});
+    {
+        const std::vector<int> res(server.begin(), server.end());
+        const std::vector<int> answer = {3, 7, 10};
+        ASSERT_EQUAL_HINT(res, answer, "Documents must be iterated over in ascending order of ids"s);
+    }
+    {
+        const auto found_docs = server.FindTopDocuments("black"sv, DocumentStatus::BANNED);
+        ASSERT_EQUAL(found_docs.size(), 1u);
+        ASSERT_EQUAL(found_docs[0].id, 3);
+        ASSERT_EQUAL(found_docs[0].rating, 4);
+        ASSERT(server.FindTopDocuments("cat"sv, DocumentStatus::BANNED).empty());
+    }
+}
+
+inline void TestCompactIndex() {
+    const auto make_text = [](int id) {
+        static const std::vector<std::string> words = {"white"s, "black"s, "fluffy"s, "cat"s, "dog"s, "parrot"s};
+        std::string text = words[id % 5] + " "s + words[id % 7 % 5] + " "s + words[id % 3 + 2];
+        return id == 42 ? text + " hamster"s : text;
+    };
+    const auto is_removed = [](int id) {
+        return id % 3 == 0 || id == 42;
+    };
+    const auto check_results = [](const std::vector<Document>& result, const std::vector<Document>& answer) {
+        ASSERT_EQUAL(result.size(), answer.size());
+        for (std::size_t i = 0; i < result.size(); ++i) {
+            ASSERT_EQUAL(result[i].id, answer[i].id);
+            ASSERT(std::abs(result[i].relevance - answer[i].relevance) < ERROR_MARGIN);
+        }
+    };
+
+    // A share of 1 disables the automatic compaction, a share of 0 compacts on every removal.
+    for (const auto& [encoding, compaction_share] : {std::pair{PostingListEncoding::PLAIN, 1.0},
+                                                    std::pair{PostingListEncoding::COMPRESSED, 1.0},
+                                                    std::pair{PostingListEncoding::PLAIN, 0.25},
+                                                    std::pair{PostingListEncoding::COMPRESSED, 0.0}}) {
+        SearchServer server(""sv);
+        SearchServer answer_server(""sv);
+        server.SetPostingListEncoding(encoding);
+        server.SetCompactionThresholds(compaction_share, compaction_share);
+        for (int id = 0; id < 500; ++id) {
+            const auto status = id % 4 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL;
+            server.AddDocument(id, make_text(id), status, {id % 10});
+            if (!is_removed(id)) {
+                answer_server.AddDocument(id, make_text(id), status, {id % 10});
+            }
+        }
+        for (int id = 0; id < 500; ++id) {
+            if (is_removed(id)) {
+                server.RemoveDocument(id);
+            }
+        }
+
+        const auto any_document = [](int, DocumentStatus, int) {
+            return true;
+        };
+        const auto check_server = [&] {
+            ASSERT_EQUAL(server.GetDocumentCount(), answer_server.GetDocumentCount());
+            ASSERT(server.FindTopDocuments("hamster"sv, any_document).empty());
+            for (const int id : answer_server) {
+                ASSERT_EQUAL(server.GetWordFrequencies(id), answer_server.GetWordFrequencies(id));
+                ASSERT(std::get<DocumentStatus>(server.MatchDocument("-fluffy cat"sv, id))
+                       == std::get<DocumentStatus>(answer_server.MatchDocument("-fluffy cat"sv, id)));
+                ASSERT_EQUAL(std::get<0>(server.MatchDocument("-fluffy cat"sv, id)).size(),
+                             std::get<0>(answer_server.MatchDocument("-fluffy cat"sv, id)).size());
+            }
+            for (const auto query : {"white cat"sv, "fluffy -dog parrot"sv, "black white hamster"sv}) {
+                check_results(server.FindTopDocuments(query, any_document, 20),
+                              answer_server.FindTopDocuments(query, any_document, 20));
+                check_results(server.FindTopDocuments(query, DocumentStatus::BANNED, 20),
+                              answer_server.FindTopDocuments(query, DocumentStatus::BANNED, 20));
+                check_results(server.FindTopDocuments(std::execution::par, query, any_document, 20),
+                              answer_server.FindTopDocuments(query, any_document, 20));
+            }
+        };
+        check_server();
+        const auto prepared_query = server.PrepareQuery("white cat -dog"sv);
+        server.CompactIndex(search_execution::par_pool);
+        check_server();
+        check_results(server.FindTopDocuments(prepared_query),
+                      answer_server.FindTopDocuments("white cat -dog"sv));
+
+        server.AddDocument(42, make_text(42), DocumentStatus::ACTUAL, {});
+        ASSERT_EQUAL(server.FindTopDocuments("hamster"sv).size(), 1u);
+    }
+
+    SearchServer server(""sv);
+    ASSERT_THROW(server.SetCompactionThresholds(-0.5), std::invalid_argument);
+}
+
+inline void TestRemoveDocuments() {
+    const auto make_server = [] {
+        SearchServer server("and in with"sv);
+        for (int id = 0; id < 300; ++id) {
+            const auto status = id % 5 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL;
+            server.AddDocument(id, (id % 3 == 0) ? "white cat"sv : "black dog and cat"sv, status, {id % 7});
+        }
+        server.SetCompactionThresholds(0.1, 0.5);
+        return server;
+    };
+    const auto check_same_results = [](const SearchServer& server, const SearchServer& answer_server) {
+        ASSERT_EQUAL(std::vector<int>(server.begin(), server.end()),
+                     std::vector<int>(answer_server.begin(), answer_server.end()));
+        for (const auto query : {"cat"sv, "black -white"sv, "white dog"sv}) {
+            const auto result = server.FindTopDocuments(query, DocumentStatus::ACTUAL, 50);
+            const auto answer = answer_server.FindTopDocuments(query, DocumentStatus::ACTUAL, 50);
+            ASSERT_EQUAL(result.size(), answer.size());
+            for (std::size_t i = 0; i < result.size(); ++i) {
+                ASSERT_EQUAL(result[i].id, answer[i].id);
+                ASSERT(std::abs(result[i].relevance - answer[i].relevance) < ERROR_MARGIN);
+            }
+        }
+    };
+
+    {
+        std::vector<int> ids_to_remove = {1'000, 7, 7};
+        for (int id = 0; id < 300; id += 2) {
+            ids_to_remove.push_back(id);
+        }
+        auto server = make_server();
+        auto answer_server = make_server();
+        server.RemoveDocuments(search_execution::par_pool, ids_to_remove);
+        for (const int id : ids_to_remove) {
+            answer_server.RemoveDocument(id);
+        }
+        ASSERT_EQUAL(server.GetDocumentCount(), 149);
+        check_same_results(server, answer_server);
+        server.RemoveDocuments(std::vector<int>{});
+        check_same_results(server, answer_server);
+    }
+    {
+        auto server = make_server();
+        auto answer_server = make_server();
+        const auto is_banned = [](int /*document_id*/, DocumentStatus status, int /*rating*/) {
+            return status == DocumentStatus::BANNED;
+        };
+        server.RemoveDocumentsIf(std::execution::par, is_banned);
+        answer_server.RemoveDocumentsIf(is_banned);
+        for (int id = 0; id < 300; id += 5) {
+            ASSERT(std::find(server.begin(), server.end(), id) == server.end());
+        }
+        ASSERT_EQUAL(server.GetDocumentCount(), 240);
+        ASSERT(server.FindTopDocuments("cat"sv, DocumentStatus::BANNED).empty());
+        check_same_results(server, answer_server);
+
+        server.RemoveDocumentsIf([](int, DocumentStatus, int) {
+            return true;
+        });
+        ASSERT_EQUAL(server.GetDocumentCount(), 0);
+        ASSERT(server.FindTopDocuments("cat"sv).empty());
+    }
 }
 
 inline void TestGetWordFrequencies() {
@@ -121,6 +384,15 @@ inline void TestGetWordFrequencies() {
         std::map<std::string_view, double> answer = {{"blue"sv, 2.0 / 4}, {"cat"sv, 1.0 / 4}, {"kitty"sv, 1.0 / 4}};
         ASSERT_EQUAL(server.GetWordFrequencies(100), answer);
     }
+    {
+        const auto term_ids = server.GetTermIds(100);
+        ASSERT_EQUAL(term_ids.end() - term_ids.begin(), 3);
+        ASSERT(std::is_sorted(term_ids.begin(), term_ids.end()));
+        server.RemoveDocument(100);
+        const auto removed_term_ids = server.GetTermIds(100);
+        ASSERT(removed_term_ids.begin() == removed_term_ids.end());
+        ASSERT(server.GetWordFrequencies(100).empty());
+    }
 }
 
 inline void TestExcludeStopWordsFromAddedDocumentContent() {
@@ -179,6 +451,86 @@ inline void TestMatchingDocuments() {
         const auto [match_words, _] = server.MatchDocument("cats -city"sv, doc_id);
         ASSERT_HINT(match_words.empty(), "Minus words must be excluded from matching"s);
     }
+    {
+        const std::vector<std::string_view> answer = { "cats"sv, "city"sv };
+        const auto [par_match_words, _] = server.MatchDocument(std::execution::par, "city beautiful cats city"sv,
+                                                               doc_id);
+        ASSERT_EQUAL(par_match_words, answer);
+        const auto [pool_match_words, __] = server.MatchDocument(search_execution::par_pool,
+                                                                 "city beautiful cats city"sv, doc_id);
+        ASSERT_EQUAL(pool_match_words, answer);
+        const auto [minus_match_words, ___] = server.MatchDocument(search_execution::par_pool, "cats -city"sv,
+                                                                   doc_id);
+        ASSERT(minus_match_words.empty());
+        const auto [adaptive_match_words, ____] = server.MatchDocument(search_execution::adaptive,
+                                                                       "city beautiful cats city"sv, doc_id);
+        ASSERT_EQUAL(adaptive_match_words, answer);
+    }    {
+        // Words are added in the order opposite to the lexicographic one.
+        server.AddDocument(1, "zebra mango apple"sv, DocumentStatus::ACTUAL, ratings);
+        const std::vector<std::string_view> answer = {"apple"sv, "mango"sv, "zebra"sv};
+        const auto query = "mango zebra apple"sv;
+        ASSERT_EQUAL_HINT(std::get<0>(server.MatchDocument(query, 1)), answer,
+                          "Matched words must be sorted lexicographically"s);
+        ASSERT_EQUAL(std::get<0>(server.MatchDocument(std::execution::par, query, 1)), answer);
+        ASSERT_EQUAL(std::get<0>(server.MatchDocument(search_execution::par_pool, query, 1)), answer);
+        ASSERT_EQUAL(std::get<0>(server.MatchDocument(server.PrepareQuery(query), 1)), answer);
+        const auto results = server.MatchDocuments(search_execution::par_pool, query, std::vector{1, doc_id});
+        ASSERT_EQUAL(std::get<0>(results[0]), answer);
+        ASSERT(std::get<0>(results[1]).empty());
+    }
+}
+
+inline void TestBatchMatchingDocuments() {
+    const auto generate_text = [](int word_count) {
+        std::string text;
+        for (int i = 0; i < word_count; ++i) {
+            text += "w"s + std::to_string(Generator<int>::Get(0, 29)) + " "s;
+        }
+        return text;
+    };
+
+    SearchServer server("w0"sv);
+    for (int id = 0; id < 500; ++id) {
+        server.AddDocument(id, generate_text(Generator<int>::Get(1, 20)),
+                           static_cast<DocumentStatus>(Generator<int>::Get(0, 3)), {1});
+    }
+    for (int id = 0; id < 500; id += Generator<int>::Get(1, 10)) {
+        server.RemoveDocument(id);
+    }
+    std::vector<int> document_ids(server.begin(), server.end());
+    std::vector<int> some_document_ids;
+    for (int i = 0; i < 100; ++i) {
+        some_document_ids.push_back(document_ids[Generator<std::size_t>::Get(0, document_ids.size() - 1)]);
+    }
+
+    const auto check = [&server](const auto& policy, const std::string& query, const std::vector<int>& ids) {
+        const auto results = server.MatchDocuments(policy, query, ids);
+        const auto prepared_results = server.MatchDocuments(policy, server.PrepareQuery(query), ids);
+        ASSERT_EQUAL(results.size(), ids.size());
+        for (std::size_t i = 0; i < ids.size(); ++i) {
+            const auto [words, status] = server.MatchDocument(query, ids[i]);
+            ASSERT_EQUAL(std::get<0>(results[i]), words);
+            ASSERT(std::get<1>(results[i]) == status);
+            ASSERT_EQUAL(std::get<0>(prepared_results[i]), words);
+        }
+    };
+    for (int i = 0; i < 20; ++i) {
+        std::string query = generate_text(Generator<int>::Get(1, 10));
+        if (i % 2 == 0) {
+            query += "-w"s + std::to_string(Generator<int>::Get(0, 29));
+        }
+        check(std::execution::seq, query, document_ids);
+        check(std::execution::seq, query, some_document_ids);
+        check(std::execution::par, query, some_document_ids);
+        check(search_execution::par_pool, query, document_ids);
+        check(search_execution::DocumentRangePolicy{3}, query, some_document_ids);
+    }
+
+    ASSERT(server.MatchDocuments("w1 w2"sv, std::vector<int>{}).empty());
+    ASSERT_EQUAL(server.MatchDocuments("w1 w2"sv, server).size(), document_ids.size());
+    ASSERT_THROW((void) server.MatchDocuments("w1"sv, std::vector<int>{document_ids[0], 1'000}),
+                 std::invalid_argument);
 }
 
 inline void TestSortingDocumentsByRelevance() {
@@ -272,6 +624,450 @@ inline void TestFindTopDocumentsWithSpecifiedStatus() {
     }
 }
 
+inline void TestFindTopDocumentsResultCount() {
+    SearchServer server(""sv);
+    for (int id = 0; id < 10; ++id) {
+        server.AddDocument(id, "cat lives in the house"sv, DocumentStatus::ACTUAL, {id});
+    }
+    ASSERT_EQUAL(server.FindTopDocuments("cat"sv).size(), SearchServer::DEFAULT_RESULT_DOCUMENT_COUNT);
+    ASSERT(server.FindTopDocuments("cat"sv, DocumentStatus::ACTUAL, 0).empty());
+
+    const auto all_docs = server.FindTopDocuments(std::execution::par, "cat"sv, DocumentStatus::ACTUAL, 100);
+    ASSERT_EQUAL(all_docs.size(), 10u);
+    for (std::size_t i = 0; i < all_docs.size(); ++i) {
+        ASSERT_EQUAL_HINT(all_docs[i].rating, static_cast<int>(9 - i),
+                          "Documents with equal relevance must be sorted by rating"s);
+    }
+    const auto all_docs_by_ranges = server.FindTopDocuments(
+            search_execution::DocumentRangePolicy{3}, "cat"sv, DocumentStatus::ACTUAL, 100);
+    ASSERT_EQUAL(all_docs_by_ranges.size(), 10u);
+    for (std::size_t i = 0; i < all_docs_by_ranges.size(); ++i) {
+        ASSERT_EQUAL(all_docs_by_ranges[i].id, all_docs[i].id);
+    }
+
+    const auto top_docs = server.FindTopDocuments(
+            "cat"sv,
+            [](auto id, auto, auto) {
+                return id % 2 == 0;
+            },
+            3);
+    ASSERT_EQUAL(top_docs.size(), 3u);
+    ASSERT_EQUAL(top_docs[0].id, 8);
+    ASSERT_EQUAL(top_docs[1].id, 6);
+    ASSERT_EQUAL(top_docs[2].id, 4);
+}
+
+// Word frequencies are skewed, so the sequential search prunes postings of the frequent words,
+// while the parallel searches score all documents.
+inline void TestDynamicPruning() {
+    const auto generate_text = [](int word_count) {
+        std::string text;
+        for (int i = 0; i < word_count; ++i) {
+            const int word_index = Generator<int>::Get(0, 49) * Generator<int>::Get(0, 49) / 49;
+            text += "w"s + std::to_string(word_index) + " "s;
+        }
+        return text;
+    };
+
+    SearchServer server("w1"sv);
+    for (int id = 0; id < 2'000; ++id) {
+        server.AddDocument(id, generate_text(Generator<int>::Get(1, 30)),
+                           static_cast<DocumentStatus>(Generator<int>::Get(0, 3)),
+                           {Generator<int>::Get(0, 10)});
+    }
+    for (int id = 0; id < 2'000; id += Generator<int>::Get(1, 20)) {
+        server.RemoveDocument(id);
+    }
+
+    std::vector<std::string> queries;
+    const auto check = [](const std::vector<Document>& pruned, const std::vector<Document>& exhaustive) {
+        ASSERT_EQUAL(pruned.size(), exhaustive.size());
+        for (std::size_t i = 0; i < pruned.size(); ++i) {
+            ASSERT_EQUAL(pruned[i].id, exhaustive[i].id);
+            ASSERT(std::abs(pruned[i].relevance - exhaustive[i].relevance) < ERROR_MARGIN);
+        }
+    };
+    for (int i = 0; i < 100; ++i) {
+        std::string query = generate_text(Generator<int>::Get(2, 10));
+        if (i % 2 == 0) {
+            query += "-w"s + std::to_string(Generator<int>::Get(10, 49));
+        }
+        const auto result_count = static_cast<std::size_t>(Generator<int>::Get(1, 20));
+        check(server.FindTopDocuments(query, DocumentStatus::ACTUAL, result_count),
+              server.FindTopDocuments(std::execution::par, query, DocumentStatus::ACTUAL, result_count));
+        check(server.FindTopDocuments(query, DocumentStatus::ACTUAL, result_count),
+              server.FindTopDocuments(search_execution::DocumentRangePolicy{7}, query, DocumentStatus::ACTUAL,
+                                      result_count));
+
+        const auto predicate = [](int id, DocumentStatus, int rating) {
+            return id % 3 != 0 && rating > 2;
+        };
+        check(server.FindTopDocuments(query, predicate, result_count),
+              server.FindTopDocuments(std::execution::par, query, predicate, result_count));
+        check(server.FindTopDocuments(query, predicate, result_count),
+              server.FindTopDocuments(search_execution::par_document_ranges, query, predicate, result_count));
+        check(server.FindTopDocuments(query, predicate, result_count),
+              server.FindTopDocuments(search_execution::par_pool, query, predicate, result_count));
+        check(server.FindTopDocuments(query, predicate, result_count),
+              server.FindTopDocuments(search_execution::AdaptivePolicy{0}, query, predicate, result_count));
+
+        const auto prepared_query = server.PrepareQuery(query);
+        check(server.FindTopDocuments(query, DocumentStatus::ACTUAL, result_count),
+              server.FindTopDocuments(prepared_query, DocumentStatus::ACTUAL, result_count));
+        check(server.FindTopDocuments(query, predicate, result_count),
+              server.FindTopDocuments(prepared_query, predicate, result_count));
+        check(server.FindTopDocuments(query, predicate, result_count),
+              server.FindTopDocuments(search_execution::par_document_ranges, prepared_query, predicate,
+                                      result_count));
+        queries.push_back(std::move(query));
+    }
+
+    const auto results = ProcessQueries(server, queries);
+    const auto pool_results = ProcessQueries(search_execution::par_pool, server, queries);
+    ASSERT_EQUAL(results.size(), pool_results.size());
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        check(results[i], pool_results[i]);
+    }
+
+    std::vector<Document> joined_results;
+    for (const auto& document : ProcessQueriesJoined(server, queries)) {
+        joined_results.push_back(document);
+    }
+    std::vector<Document> joined_pool_results;
+    for (const auto& document : ProcessQueriesJoined(search_execution::par_pool, server, queries)) {
+        joined_pool_results.push_back(document);
+    }
+    check(joined_results, joined_pool_results);
+}
+
+inline void TestPreparedQuery() {
+    SearchServer server("and in"sv);
+    server.AddDocument(0, "white cat and fashion collar"sv, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(1, "fluffy cat fluffy tail"sv, DocumentStatus::ACTUAL, {2});
+    server.AddDocument(2, "well-groomed dog expressive eyes"sv, DocumentStatus::ACTUAL, {3});
+
+    const auto check = [](const std::vector<Document>& prepared, const std::vector<Document>& raw) {
+        ASSERT_EQUAL(prepared.size(), raw.size());
+        for (std::size_t i = 0; i < prepared.size(); ++i) {
+            ASSERT_EQUAL(prepared[i].id, raw[i].id);
+            ASSERT(std::abs(prepared[i].relevance - raw[i].relevance) < ERROR_MARGIN);
+        }
+    };
+
+    const auto raw_query = "fluffy cat in collar -dog parrot cat"sv;
+    const auto prepared_query = server.PrepareQuery(raw_query);
+    check(server.FindTopDocuments(prepared_query), server.FindTopDocuments(raw_query));
+    check(server.FindTopDocuments(std::execution::par, prepared_query, DocumentStatus::ACTUAL),
+          server.FindTopDocuments(raw_query));
+    check(server.FindTopDocuments(search_execution::par_pool, prepared_query, DocumentStatus::ACTUAL, 1),
+          server.FindTopDocuments(raw_query, DocumentStatus::ACTUAL, 1));
+    {
+        const auto [words, status] = server.MatchDocument(prepared_query, 1);
+        const std::vector<std::string_view> answer = {"cat"sv, "fluffy"sv};
+        ASSERT_EQUAL(words, answer);
+        ASSERT(status == DocumentStatus::ACTUAL);
+        ASSERT(std::get<0>(server.MatchDocument(prepared_query, 2)).empty());
+    }
+
+    // Words absent from all documents when the query was prepared are found after they are added.
+    server.AddDocument(3, "parrot and dog"sv, DocumentStatus::ACTUAL, {4});
+    server.AddDocument(4, "parrot and cat"sv, DocumentStatus::ACTUAL, {5});
+    check(server.FindTopDocuments(prepared_query), server.FindTopDocuments(raw_query));
+    ASSERT_EQUAL(std::get<0>(server.MatchDocument(prepared_query, 4)).size(), 2u);
+    server.RemoveDocument(1);
+    check(server.FindTopDocuments(prepared_query), server.FindTopDocuments(raw_query));
+
+    const SearchServer copied_server = server;
+    check(copied_server.FindTopDocuments(prepared_query), server.FindTopDocuments(raw_query));
+
+    // A server given another index by assignment or `LoadIndex` resolves the words again,
+    // even if both indexes had as many changes.
+    {
+        SearchServer other_server(""sv);
+        other_server.AddDocument(7, "parrot"sv, DocumentStatus::ACTUAL, {1});
+        other_server.AddDocument(8, "cat"sv, DocumentStatus::ACTUAL, {1});
+        SearchServer assigned_server(""sv);
+        assigned_server.AddDocument(0, "cat dog"sv, DocumentStatus::ACTUAL, {1});
+        assigned_server.AddDocument(1, "dog"sv, DocumentStatus::ACTUAL, {1});
+        const auto cat_query = assigned_server.PrepareQuery("cat"sv);
+        assigned_server = other_server;
+        check(assigned_server.FindTopDocuments(cat_query), other_server.FindTopDocuments("cat"sv));
+
+        const auto path = (std::filesystem::temp_directory_path() / "search_server_test.index"s).string();
+        other_server.SaveIndex(path);
+        SearchServer loaded_server(""sv);
+        const auto empty_query = loaded_server.PrepareQuery("cat"sv);
+        loaded_server = SearchServer::LoadIndex(path);
+        std::filesystem::remove(path);
+        check(loaded_server.FindTopDocuments(empty_query), other_server.FindTopDocuments("cat"sv));
+        ASSERT_EQUAL(loaded_server.FindTopDocuments(empty_query).size(), 1u);
+    }
+
+    ASSERT_THROW((void) server.PrepareQuery("cat --dog"sv), std::invalid_argument);
+    ASSERT_THROW((void) server.MatchDocument(server.PrepareQuery("cat"sv), 1), std::invalid_argument);
+}
+
+inline void TestAdaptivePolicy() {
+    using search_execution::QueryExecution;
+
+    SearchServer server(""sv);
+    server.AddDocument(0, "white cat"sv, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(1, "black cat"sv, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(2, "black dog"sv, DocumentStatus::ACTUAL, {1});
+    {
+        const auto cost = server.EstimateQueryCost("cat black cat -white parrot"sv);
+        ASSERT_EQUAL(cost.term_count, 2u);
+        ASSERT_EQUAL(cost.posting_count, 4u);
+        ASSERT_EQUAL(cost.max_posting_count, 2u);
+        ASSERT_EQUAL(cost.document_count, 3u);
+    }
+    {
+        SearchServer removal_server(""sv);
+        removal_server.SetCompactionThresholds(1.0, 1.0);
+        removal_server.AddDocument(0, "white cat"sv, DocumentStatus::ACTUAL, {1});
+        removal_server.AddDocument(1, "black cat"sv, DocumentStatus::ACTUAL, {1});
+        removal_server.AddDocument(2, "black dog"sv, DocumentStatus::ACTUAL, {1});
+        removal_server.RemoveDocument(1);
+        const auto cost = removal_server.EstimateQueryCost("cat black"sv);
+        ASSERT_EQUAL(cost.term_count, 2u);
+        ASSERT_EQUAL(cost.posting_count, 2u);
+        ASSERT_EQUAL(cost.max_posting_count, 1u);
+        ASSERT_EQUAL(cost.document_count, 2u);
+    }
+
+    const search_execution::AdaptivePolicy policy{100, 1.5, 10};
+    const auto choose = [&policy](std::size_t term_count, std::size_t posting_count, std::size_t max_posting_count,
+                                  std::size_t worker_count) {
+        return search_execution::ChooseQueryExecution(
+                policy, {term_count, posting_count, max_posting_count, 1'000}, worker_count);
+    };
+    ASSERT(choose(4, 99, 25, 4) == QueryExecution::SEQUENTIAL);
+    ASSERT(choose(4, 400, 100, 1) == QueryExecution::SEQUENTIAL);
+    ASSERT(choose(4, 400, 100, 4) == QueryExecution::TERMS);
+    ASSERT(choose(4, 400, 300, 4) == QueryExecution::DOCUMENT_RANGES);
+    ASSERT(choose(2, 400, 200, 4) == QueryExecution::DOCUMENT_RANGES);
+    ASSERT(choose(8, 4'000, 500, 4) == QueryExecution::DOCUMENT_RANGES);
+}
+
+inline void TestResultCache() {
+    SearchServer server("and"sv);
+    server.AddDocument(0, "white cat and fashion collar"sv, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(1, "fluffy cat fluffy tail"sv, DocumentStatus::ACTUAL, {2});
+    server.AddDocument(2, "well-groomed dog expressive eyes"sv, DocumentStatus::BANNED, {3});
+    const SearchServer uncached_server = server;
+    server.EnableResultCache(10, 2);
+
+    const auto check = [](const std::vector<Document>& cached, const std::vector<Document>& uncached) {
+        ASSERT_EQUAL(cached.size(), uncached.size());
+        for (std::size_t i = 0; i < cached.size(); ++i) {
+            ASSERT_EQUAL(cached[i].id, uncached[i].id);
+            ASSERT(std::abs(cached[i].relevance - uncached[i].relevance) < ERROR_MARGIN);
+        }
+    };
+    const auto expect_statistics = [&server](std::size_t hit_count, std::size_t miss_count) {
+        const auto statistics = server.GetResultCacheStatistics();
+        ASSERT_EQUAL(statistics.hit_count, hit_count);
+        ASSERT_EQUAL(statistics.miss_count, miss_count);
+    };
+
+    check(server.FindTopDocuments("fluffy cat -dog"sv), uncached_server.FindTopDocuments("fluffy cat -dog"sv));
+    expect_statistics(0, 1);
+    check(server.FindTopDocuments("cat fluffy -dog cat and"sv), uncached_server.FindTopDocuments("fluffy cat -dog"sv));
+    expect_statistics(1, 1);
+    check(server.FindTopDocuments(std::execution::par, "cat fluffy -dog"sv, DocumentStatus::ACTUAL),
+          uncached_server.FindTopDocuments("fluffy cat -dog"sv));
+    expect_statistics(2, 1);
+
+    // Status and result count are parts of the key, predicates aren't cached.
+    check(server.FindTopDocuments("fluffy cat -dog"sv, DocumentStatus::BANNED),
+          uncached_server.FindTopDocuments("fluffy cat -dog"sv, DocumentStatus::BANNED));
+    check(server.FindTopDocuments("fluffy cat -dog"sv, DocumentStatus::ACTUAL, 1),
+          uncached_server.FindTopDocuments("fluffy cat -dog"sv, DocumentStatus::ACTUAL, 1));
+    expect_statistics(2, 3);
+    (void) server.FindTopDocuments("fluffy cat -dog"sv, [](int, DocumentStatus, int) { return true; });
+    expect_statistics(2, 3);
+
+    server.AddDocument(3, "fluffy fluffy cat"sv, DocumentStatus::ACTUAL, {4});
+    ASSERT_EQUAL(server.FindTopDocuments("fluffy cat -dog"sv).front().id, 3);
+    expect_statistics(2, 4);
+    server.RemoveDocument(3);
+    check(server.FindTopDocuments("fluffy cat -dog"sv), uncached_server.FindTopDocuments("fluffy cat -dog"sv));
+    expect_statistics(2, 5);
+
+    server.DisableResultCache();
+    check(server.FindTopDocuments("fluffy cat -dog"sv), uncached_server.FindTopDocuments("fluffy cat -dog"sv));
+    expect_statistics(0, 0);
+}
+
+inline void TestShardedLruCache() {
+    ShardedLruCache<int, std::string> cache(2, 1);
+    cache.Insert(1, "one"s);
+    cache.Insert(2, "two"s);
+    ASSERT_EQUAL(cache.Find(1).value_or(""s), "one"s);
+    // The least recently used entry is evicted.
+    cache.Insert(3, "three"s);
+    ASSERT(!cache.Find(2));
+    ASSERT_EQUAL(cache.Find(1).value_or(""s), "one"s);
+    ASSERT_EQUAL(cache.Find(3).value_or(""s), "three"s);
+    cache.Insert(3, "drei"s);
+    ASSERT_EQUAL(cache.Find(3).value_or(""s), "drei"s);
+    ASSERT_EQUAL(cache.GetStatistics().hit_count, 4u);
+    ASSERT_EQUAL(cache.GetStatistics().miss_count, 1u);
+
+    const auto copy = cache;
+    ASSERT_EQUAL(copy.GetStatistics().hit_count, 0u);
+    cache.Clear();
+    ASSERT(!cache.Find(1));
+
+    ShardedLruCache<int, int> sharded_cache(100, 8);
+    for (int i = 0; i < 1'000; ++i) {
+        sharded_cache.Insert(i, i * i);
+    }
+    int found_count = 0;
+    for (int i = 0; i < 1'000; ++i) {
+        if (const auto value = sharded_cache.Find(i)) {
+            ASSERT_EQUAL(*value, i * i);
+            ++found_count;
+        }
+    }
+    ASSERT(found_count <= 104);
+    ASSERT(found_count >= 96);
+
+    ShardedLruCache<int, int> empty_cache(0, 0);
+    empty_cache.Insert(1, 1);
+    ASSERT(!empty_cache.Find(1));
+}
+
+inline void TestThreadPool() {
+    ThreadPool pool(3);
+    ASSERT_EQUAL(pool.GetThreadCount(), 3u);
+    {
+        std::vector<int> values(1'000);
+        pool.ParallelFor(values.size(), [&values](std::size_t index) {
+            values[index] = static_cast<int>(index);
+        });
+        std::vector<int> answer(values.size());
+        std::iota(answer.begin(), answer.end(), 0);
+        ASSERT_EQUAL(values, answer);
+    }
+    {
+        std::atomic_int sum = 0;
+        pool.ParallelFor(10, [&pool, &sum](std::size_t outer_index) {
+            pool.ParallelFor(100, [&sum, outer_index](std::size_t inner_index) {
+                sum += static_cast<int>(outer_index * inner_index);
+            });
+        });
+        ASSERT_EQUAL(sum.load(), 45 * 4'950);
+    }
+    {
+        std::atomic_int call_count = 0;
+        bool is_thrown = false;
+        try {
+            pool.ParallelFor(100, [&call_count](std::size_t index) {
+                ++call_count;
+                if (index % 10 == 0) {
+                    throw std::runtime_error("index "s + std::to_string(index));
+                }
+            });
+        } catch (const std::runtime_error&) {
+            is_thrown = true;
+        }
+        ASSERT(is_thrown);
+        ASSERT_EQUAL(call_count.load(), 100);
+    }
+    {
+        std::atomic_int call_count = 0;
+        search_execution::ParallelFor(search_execution::ThreadPoolPolicy{&pool}, 0, [&call_count](std::size_t) {
+            ++call_count;
+        });
+        search_execution::ParallelFor(search_execution::ThreadPoolPolicy{&pool}, 1, [&call_count](std::size_t) {
+            ++call_count;
+        });
+        ASSERT_EQUAL(call_count.load(), 1);
+        ASSERT_EQUAL(search_execution::GetWorkerCount(search_execution::ThreadPoolPolicy{&pool}), 4u);
+    }
+    {
+        ThreadPool empty_pool(0);
+        int sum = 0;
+        empty_pool.ParallelFor(10, [&sum](std::size_t index) {
+            sum += static_cast<int>(index);
+        });
+        ASSERT_EQUAL(sum, 45);
+    }
+}
+
+inline void TestScoreAccumulator() {
+    const auto get_relevances = [](ScoreAccumulator& accumulator) {
+        std::vector<std::pair<int, double>> relevances;
+        accumulator.ForEachOrdered([&relevances](int ordinal, double relevance) {
+            relevances.emplace_back(ordinal, relevance);
+        });
+        return relevances;
+    };
+
+    const ScoreAccumulator* retained_accumulator = nullptr;
+    {
+        const auto accumulator = ScoreAccumulator::Acquire(10);
+        ASSERT(accumulator->empty());
+        (*accumulator)[7] += 1.0;
+        (*accumulator)[2] += 0.5;
+        (*accumulator)[7] += 0.5;
+        (*accumulator)[0] += 0.0;
+        const std::vector<std::pair<int, double>> answer = {{0, 0.0}, {2, 0.5}, {7, 1.5}};
+        std::vector<std::pair<int, double>> unordered_relevances;
+        accumulator->ForEach([&unordered_relevances](int ordinal, double relevance) {
+            unordered_relevances.emplace_back(ordinal, relevance);
+        });
+        std::sort(unordered_relevances.begin(), unordered_relevances.end());
+        ASSERT_EQUAL(unordered_relevances, answer);
+        ASSERT_EQUAL(get_relevances(*accumulator), answer);
+
+        const auto nested_accumulator = ScoreAccumulator::Acquire(10);
+        ASSERT(&*nested_accumulator != &*accumulator);
+        ASSERT(nested_accumulator->empty());
+        retained_accumulator = &*accumulator;
+    }
+    {
+        const auto accumulator = ScoreAccumulator::Acquire(100);
+        ASSERT(accumulator->empty());
+        (*accumulator)[99] += 1.0;
+        (*accumulator)[7] += 1.0;
+        const std::vector<std::pair<int, double>> answer = {{7, 1.0}, {99, 1.0}};
+        ASSERT_EQUAL(get_relevances(*accumulator), answer);
+        ASSERT(&*accumulator == retained_accumulator || accumulator->size() == 2);
+    }
+
+    // A retained accumulator shrinks once a much smaller index is searched.
+    {
+        const auto accumulator = ScoreAccumulator::Acquire(100'000);
+        ASSERT(accumulator->GetDocumentCapacity() >= 100'000u);
+    }
+    {
+        const auto accumulator = ScoreAccumulator::Acquire(10);
+        ASSERT_EQUAL(accumulator->GetDocumentCapacity(), 10u);
+        (*accumulator)[9] += 1.0;
+        ASSERT_EQUAL(get_relevances(*accumulator).size(), 1u);
+    }
+}
+
+inline void TestTopK() {
+    auto is_greater = [](int lhs, int rhs) {
+        return lhs > rhs;
+    };
+    std::vector<int> values(1'000);
+    std::generate(values.begin(), values.end(), [] { return Generator<int>::Get(-1'000, 1'000); });
+    for (const std::size_t k : {0u, 1u, 10u, 2'000u}) {
+        TopK<int, decltype(is_greater)> top(k, is_greater);
+        for (const int value : values) {
+            top.Push(value);
+        }
+        auto answer = values;
+        std::sort(answer.begin(), answer.end(), is_greater);
+        answer.resize(std::min(k, answer.size()));
+        ASSERT_EQUAL(std::move(top).Release(), answer);
+    }
+}
+
 inline void TestCorrectnessRelevance() {
     const std::vector<int> ratings = {1, 2, 3};
     SearchServer server("is are was a an in the with near at"sv);
@@ -287,6 +1083,215 @@ inline void TestCorrectnessRelevance() {
     }
 }
 
+inline void TestIndexFile() {
+    const auto path = (std::filesystem::temp_directory_path() / "search_server_test.index"s).string();
+    const auto queries = {"cat city -dog"sv, "funny dog"sv, "town of lights"sv, "parrot"sv};
+    const auto assert_equal_servers = [&](const SearchServer& lhs, const SearchServer& rhs) {
+        ASSERT_EQUAL(lhs.GetDocumentCount(), rhs.GetDocumentCount());
+        ASSERT(std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end()));
+        for (const int id : lhs) {
+            ASSERT_EQUAL(lhs.GetTermFrequencies(id), rhs.GetTermFrequencies(id));
+        }
+        for (const auto query : queries) {
+            for (const auto status : {DocumentStatus::ACTUAL, DocumentStatus::BANNED}) {
+                const auto lhs_documents = lhs.FindTopDocuments(query, status);
+                const auto rhs_documents = rhs.FindTopDocuments(query, status);
+                ASSERT_EQUAL(lhs_documents.size(), rhs_documents.size());
+                for (std::size_t i = 0; i < lhs_documents.size(); ++i) {
+                    ASSERT_EQUAL(lhs_documents[i].id, rhs_documents[i].id);
+                    ASSERT_EQUAL(lhs_documents[i].rating, rhs_documents[i].rating);
+                    ASSERT(std::abs(lhs_documents[i].relevance - rhs_documents[i].relevance) < ERROR_MARGIN);
+                }
+            }
+        }
+    };
+
+    for (const auto encoding : {PostingListEncoding::PLAIN, PostingListEncoding::COMPRESSED}) {
+        SearchServer server("in the of"sv);
+        server.SetPostingListEncoding(encoding);
+        for (int id = 0; id < 300; ++id) {
+            const auto status = id % 5 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL;
+            server.AddDocument(id, id % 3 == 0 ? "cat in the city"sv : id % 3 == 1 ? "funny dog in the town"sv
+                                                                                   : "town of lights"sv,
+                               status, {id % 7, 1});
+        }
+        server.AddDocument(1000, "parrot cat"sv, DocumentStatus::ACTUAL, {1});
+        server.RemoveDocument(1000);
+        server.RemoveDocument(3);
+
+        server.SaveIndex(path);
+        auto loaded_server = SearchServer::LoadIndex(path);
+        assert_equal_servers(server, loaded_server);
+        ASSERT_THROW(loaded_server.AddDocument(0, "cat"sv, DocumentStatus::ACTUAL, {1}), std::invalid_argument);
+
+        // Both servers reuse the same term ids and document ordinals.
+        for (auto* modified_server : {&server, &loaded_server}) {
+            modified_server->AddDocument(3, "parrot in the city"sv, DocumentStatus::ACTUAL, {5});
+            modified_server->RemoveDocument(5);
+        }
+        assert_equal_servers(server, loaded_server);
+        ASSERT(server.GetTermIds(3).begin()[0] == loaded_server.GetTermIds(3).begin()[0]);
+    }
+
+    // The new file replaces the old one through a temporary file that doesn't outlive the save.
+    {
+        SearchServer server(""sv);
+        server.AddDocument(0, "cat in the city"sv, DocumentStatus::ACTUAL, {1});
+        server.SaveIndex(path);
+        server.AddDocument(1, "funny dog"sv, DocumentStatus::ACTUAL, {2});
+        std::ofstream(path + ".tmp"s) << "stale"s;
+        server.SaveIndex(path);
+        ASSERT(!std::filesystem::exists(path + ".tmp"s));
+        assert_equal_servers(server, SearchServer::LoadIndex(path));
+
+        const auto missing_path = (std::filesystem::temp_directory_path() / "search_server_missing"s
+                                   / "search_server_test.index"s).string();
+        ASSERT_THROW(server.SaveIndex(missing_path), std::runtime_error);
+    }
+
+    // Saving the same index twice gives the same bytes, so no uninitialized padding is written.
+    {
+        const auto read_file = [&path] {
+            std::ifstream input(path, std::ios::binary);
+            return std::string(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+        };
+        SearchServer server(""sv);
+        server.SetPostingListEncoding(PostingListEncoding::COMPRESSED);
+        for (int id = 0; id < 300; ++id) {
+            server.AddDocument(id, id % 2 == 0 ? "cat"sv : "cat dog"sv, DocumentStatus::ACTUAL, {1});
+        }
+        server.SaveIndex(path);
+        const auto content = read_file();
+        SearchServer(server).SaveIndex(path);
+        ASSERT(content == read_file());
+    }
+
+    // Postings out of order or of unknown documents are rejected.
+    {
+        const auto to_bytes = [](auto... values) {
+            std::string bytes;
+            (bytes.append(reinterpret_cast<const char*>(&values), sizeof(values)), ...);
+            return bytes;
+        };
+        SearchServer server(""sv);
+        server.SetPostingListEncoding(PostingListEncoding::COMPRESSED);
+        for (int id = 0; id < 300; ++id) {
+            server.AddDocument(id, id < 298 ? "cat"sv : "cat parrot"sv, DocumentStatus::ACTUAL, {1});
+        }
+        // The compressed blocks of "cat" end with ordinals 127 and 255, "parrot" has a plain tail of 298 and 299
+        // followed by the element count of its term counts.
+        const std::pair<std::string, std::string> corruptions[] = {
+                {to_bytes(298, 299, std::uint64_t{2}), to_bytes(299, 298, std::uint64_t{2})},
+                {to_bytes(298, 299, std::uint64_t{2}), to_bytes(298, 300, std::uint64_t{2})},
+                {to_bytes(std::uint64_t{2}, 127, std::uint32_t{0}), to_bytes(std::uint64_t{2}, 126, std::uint32_t{0})},
+        };
+        for (const auto& [original, corrupted] : corruptions) {
+            server.SaveIndex(path);
+            std::string content;
+            {
+                std::ifstream input(path, std::ios::binary);
+                content.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+            }
+            const auto position = content.find(original);
+            ASSERT(position != std::string::npos);
+            content.replace(position, original.size(), corrupted);
+            std::ofstream(path, std::ios::binary | std::ios::trunc) << content;
+            ASSERT_THROW((void) SearchServer::LoadIndex(path), std::invalid_argument);
+        }
+    }
+
+    // A file is rejected unless it is a whole index file of the supported version.
+    SearchServer(""sv).SaveIndex(path);
+    const auto file_size = std::filesystem::file_size(path);
+    std::filesystem::resize_file(path, file_size - 1);
+    ASSERT_THROW((void) SearchServer::LoadIndex(path), std::invalid_argument);
+    std::ofstream(path) << "cat in the city"s;
+    ASSERT_THROW((void) SearchServer::LoadIndex(path), std::invalid_argument);
+    std::filesystem::remove(path);
+    ASSERT_THROW((void) SearchServer::LoadIndex(path), std::runtime_error);
+}
+
+inline void TestWriteAheadLog() {
+    const auto directory = std::filesystem::temp_directory_path();
+    const auto index_path = (directory / "search_server_test.index"s).string();
+    const auto log_path = (directory / "search_server_test.log"s).string();
+    std::filesystem::remove(log_path);
+    const auto assert_equal_servers = [](const SearchServer& lhs, const SearchServer& rhs) {
+        ASSERT(std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end()));
+        for (const int id : lhs) {
+            ASSERT_EQUAL(lhs.GetWordFrequencies(id), rhs.GetWordFrequencies(id));
+            ASSERT(lhs.MatchDocument("cat city dog"sv, id) == rhs.MatchDocument("cat city dog"sv, id));
+        }
+    };
+    const auto count_records = [&] {
+        std::size_t record_count = 0;
+        WriteAheadLog::ForEachRecord(log_path, [&record_count](const WriteAheadLog::Record&) {
+            ++record_count;
+        });
+        return record_count;
+    };
+
+    SearchServer server("in the"sv);
+    {
+        WriteAheadLog log(log_path);
+        server.AttachWriteAheadLog(&log);
+        for (int id = 0; id < 10; ++id) {
+            server.AddDocument(id, id % 2 == 0 ? "cat in the city"sv : "dog in the town"sv,
+                               DocumentStatus::ACTUAL, {id});
+        }
+        ASSERT_THROW(server.AddDocument(0, "cat"sv, DocumentStatus::ACTUAL, {}), std::invalid_argument);
+        server.SaveIndex(index_path);
+
+        // The changes after the index is saved are found in the log only.
+        server.AddDocument(10, "funny dog"sv, DocumentStatus::BANNED, {1, 2, 3});
+        server.RemoveDocument(3);
+        server.RemoveDocument(100);
+        server.RemoveDocument(search_execution::par_pool, 4);
+        server.AddDocuments({{4, "cat and dog"sv, DocumentStatus::ACTUAL, {5}}});
+        log.Commit();
+        ASSERT_EQUAL(count_records(), 14u);
+
+        // A copy doesn't record its changes to the log of the original.
+        SearchServer server_copy = server;
+        server_copy.AddDocument(20, "parrot"sv, DocumentStatus::ACTUAL, {});
+        log.Commit();
+        ASSERT_EQUAL(count_records(), 14u);
+        server.AttachWriteAheadLog(nullptr);
+    }
+
+    auto recovered_server = SearchServer::LoadIndex(index_path);
+    recovered_server.ReplayWriteAheadLog(log_path);
+    assert_equal_servers(server, recovered_server);
+
+    // The whole log restores the server without an index, and replaying it again changes nothing.
+    SearchServer replayed_server("in the"sv);
+    replayed_server.ReplayWriteAheadLog(log_path);
+    replayed_server.ReplayWriteAheadLog(log_path);
+    assert_equal_servers(server, replayed_server);
+
+    // A record torn by a crash is ignored and cut off when the log is reopened.
+    std::ofstream(log_path, std::ios::binary | std::ios::app) << "\x20\x00\x00\x00torn"s;
+    ASSERT_EQUAL(count_records(), 14u);
+    {
+        WriteAheadLog log(log_path);
+        recovered_server.AttachWriteAheadLog(&log);
+        recovered_server.RemoveDocument(10);
+    }
+    ASSERT_EQUAL(count_records(), 15u);
+    server.ReplayWriteAheadLog(log_path);
+    assert_equal_servers(server, recovered_server);
+    {
+        WriteAheadLog log(log_path);
+        log.Truncate();
+    }
+    ASSERT_EQUAL(count_records(), 0u);
+
+    ASSERT_THROW(WriteAheadLog::ForEachRecord(index_path, [](const WriteAheadLog::Record&) {}),
+                 std::invalid_argument);
+    std::filesystem::remove(index_path);
+    std::filesystem::remove(log_path);
+}
+
 inline void TestRemoveDuplicates() {
     SearchServer server("and in with"sv);
     {
@@ -321,6 +1326,301 @@ inline void TestRemoveDuplicates() {
         const std::vector<int> answer = {0, 1};
         ASSERT_EQUAL(res, answer);
     }
+    {
+        server.AddDocument(2, "white cat"sv, DocumentStatus::ACTUAL, ratings);
+        server.AddDocument(3, "cat black"sv, DocumentStatus::ACTUAL, ratings);
+        server.AddDocument(4, "cat in white"sv, DocumentStatus::ACTUAL, ratings);
+        server.AddDocument(5, "white dog"sv, DocumentStatus::ACTUAL, ratings);
+        RemoveDuplicates(search_execution::par_pool, server);
+        std::vector<int> res(server.begin(), server.end());
+        std::sort(res.begin(), res.end());
+        const std::vector<int> answer = {0, 1, 5};
+        ASSERT_EQUAL(res, answer);
+        ASSERT(server.FindTopDocuments("white"sv).size() == 2);
+    }
+}
+
+inline std::vector<std::pair<int, PostingList::TermCount>> GetPostings(const PostingList& posting_list) {
+    std::vector<std::pair<int, PostingList::TermCount>> postings;
+    posting_list.ForEach([&postings](int document_id, PostingList::TermCount term_count) {
+        postings.emplace_back(document_id, term_count);
+    });
+    return postings;
+}
+
+// Term frequencies of the postings are expected to be equal to their term counts.
+inline void TestPostingListCursor(const PostingList& posting_list,
+                                  const std::map<int, PostingList::TermCount>& answer) {
+    {
+        PostingList::Cursor cursor(posting_list);
+        for (const auto [document_id, term_count] : answer) {
+            ASSERT_EQUAL(cursor.GetDocumentId(), document_id);
+            ASSERT_EQUAL(cursor.GetTermCount(), term_count);
+            ASSERT(cursor.GetBlockLastDocumentId(document_id) >= document_id);
+            ASSERT(cursor.GetBlockMaxTermFrequency(document_id) >= term_count);
+            ASSERT(posting_list.GetMaxTermFrequency() >= term_count);
+            cursor.Next();
+        }
+        ASSERT(cursor.IsEnd());
+    }
+    {
+        PostingList::Cursor cursor(posting_list);
+        for (int document_id = 0; !cursor.IsEnd(); document_id += Generator<int>::Get(1, 1'000)) {
+            cursor.SkipTo(document_id);
+            const auto iter = answer.lower_bound(document_id);
+            ASSERT_EQUAL(cursor.GetDocumentId(),
+                         iter == answer.end() ? PostingList::Cursor::END_DOCUMENT_ID : iter->first);
+        }
+    }
+}
+
+inline void TestPostingList(PostingListEncoding encoding) {
+    PostingList posting_list(encoding);
+    ASSERT(posting_list.empty());
+
+    posting_list.Add(5, 1, 1.0);
+    posting_list.Add(10, 2, 2.0);
+    posting_list.Add(1, 2, 2.0);
+    posting_list.Add(5, 1, 1.0);
+    {
+        const std::vector<std::pair<int, PostingList::TermCount>> answer = {{1, 2}, {5, 2}, {10, 2}};
+        ASSERT_EQUAL(GetPostings(posting_list), answer);
+    }
+    {
+        ASSERT(!posting_list.Erase(2));
+        ASSERT(posting_list.Erase(5));
+        const std::vector<std::pair<int, PostingList::TermCount>> answer = {{1, 2}, {10, 2}};
+        ASSERT_EQUAL(GetPostings(posting_list), answer);
+        ASSERT_EQUAL(posting_list.size(), 2u);
+    }
+
+    std::map<int, PostingList::TermCount> answer = {{1, 2}, {10, 2}};
+    for (int i = 0; i < 1'000; ++i) {
+        const int document_id = Generator<int>::Get(0, 100'000);
+        const auto term_count = Generator<PostingList::TermCount>::Get(1, 1'000);
+        posting_list.Add(document_id, term_count, term_count);
+        answer[document_id] += term_count;
+    }
+    for (int i = 0; i < 100; ++i) {
+        const int document_id = Generator<int>::Get(0, 100'000);
+        ASSERT_EQUAL(posting_list.Erase(document_id), answer.erase(document_id) > 0);
+    }
+    const std::vector<std::pair<int, PostingList::TermCount>> answer_postings(answer.begin(), answer.end());
+    ASSERT_EQUAL(GetPostings(posting_list), answer_postings);
+    TestPostingListCursor(posting_list, answer);
+
+    posting_list.SetEncoding(encoding == PostingListEncoding::PLAIN
+                             ? PostingListEncoding::COMPRESSED
+                             : PostingListEncoding::PLAIN);
+    ASSERT_EQUAL(GetPostings(posting_list), answer_postings);
+    TestPostingListCursor(posting_list, answer);
+
+    const std::size_t odd_count = std::count_if(answer.begin(), answer.end(), [](const auto& posting) {
+        return posting.first % 2 != 0;
+    });
+    const auto is_odd = [](int document_id) {
+        return document_id % 2 != 0;
+    };
+    const auto term_frequency = [](int /*document_id*/, PostingList::TermCount term_count) {
+        return static_cast<double>(term_count);
+    };
+    ASSERT_EQUAL(posting_list.EraseIf(is_odd, term_frequency), odd_count);
+    ASSERT_EQUAL(posting_list.EraseIf(is_odd, term_frequency), 0u);
+    for (auto iter = answer.begin(); iter != answer.end();) {
+        iter = is_odd(iter->first) ? answer.erase(iter) : std::next(iter);
+    }
+    const std::vector<std::pair<int, PostingList::TermCount>> even_postings(answer.begin(), answer.end());
+    ASSERT_EQUAL(GetPostings(posting_list), even_postings);
+    TestPostingListCursor(posting_list, answer);
+}
+
+inline void TestPostingListEncodings() {
+    TestPostingList(PostingListEncoding::PLAIN);
+    TestPostingList(PostingListEncoding::COMPRESSED);
+}
+
+inline void TestCompressedIndex() {
+    SearchServer server("and in with"sv);
+    for (int id = 0; id < 1'000; ++id) {
+        server.AddDocument(id, (id % 3 == 0) ? "white cat"sv : "black dog and cat"sv, DocumentStatus::ACTUAL, {id});
+    }
+    const auto plain_result = server.FindTopDocuments("cat dog -white"sv);
+    server.SetPostingListEncoding(PostingListEncoding::COMPRESSED);
+    server.RemoveDocument(1);
+    server.AddDocument(1, "black dog and cat"sv, DocumentStatus::ACTUAL, {1});
+    const auto compressed_result = server.FindTopDocuments("cat dog -white"sv);
+    ASSERT_EQUAL(compressed_result.size(), plain_result.size());
+    for (std::size_t i = 0; i < plain_result.size(); ++i) {
+        ASSERT_EQUAL(compressed_result[i].id, plain_result[i].id);
+        ASSERT(std::abs(compressed_result[i].relevance - plain_result[i].relevance) < ERROR_MARGIN);
+    }
+}
+
+inline void TestSetIntersection() {
+    const auto generate_set = [](std::size_t size, std::uint32_t max_value) {
+        std::vector<std::uint32_t> values(size);
+        for (auto& value : values) {
+            value = Generator<std::uint32_t>::Get(0, max_value);
+        }
+        std::sort(values.begin(), values.end());
+        values.erase(std::unique(values.begin(), values.end()), values.end());
+        return values;
+    };
+
+    // Sets of close sizes are compared element by element, a small set gallops over a large one.
+    for (const auto& [lhs_size, rhs_size] : {std::pair{0u, 10u}, std::pair{7u, 9u}, std::pair{100u, 130u},
+                                            std::pair{3u, 1'000u}, std::pair{1'000u, 20u}}) {
+        const auto lhs = generate_set(lhs_size, 300);
+        const auto rhs = generate_set(rhs_size, 300);
+        std::vector<std::uint32_t> answer;
+        std::set_intersection(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), std::back_inserter(answer));
+
+        std::vector<std::uint32_t> common(std::min(lhs.size(), rhs.size()));
+        common.resize(set_intersection::Intersect(lhs.data(), lhs.size(), rhs.data(), rhs.size(), common.data()));
+        ASSERT_EQUAL(common, answer);
+        ASSERT_EQUAL(set_intersection::Intersects(lhs.data(), lhs.size(), rhs.data(), rhs.size()), !answer.empty());
+    }
+
+    const std::vector<std::uint32_t> values = {1, 3, 5, 7, 9, 11, 13, 15, 17};
+    for (std::uint32_t value = 0; value < 20; ++value) {
+        ASSERT_EQUAL(set_intersection::Intersects(&value, 1, values.data(), values.size()), value % 2 == 1 && value < 18);
+    }
+}
+
+inline void TestSplitIntoWords() {
+    const auto split_by_chars = [](std::string_view text) {
+        std::vector<std::string_view> words;
+        std::size_t word_begin = 0;
+        for (std::size_t i = 0; i <= text.size(); ++i) {
+            if (i == text.size() || text[i] == ' ') {
+                if (i > word_begin) {
+                    words.push_back(text.substr(word_begin, i - word_begin));
+                }
+                word_begin = i + 1;
+            }
+        }
+        return words;
+    };
+
+    ASSERT(SplitIntoWordsView(""sv).empty());
+    ASSERT(SplitIntoWordsView("    "sv).empty());
+    ASSERT_EQUAL(SplitIntoWords("  cat in  the city "sv), (std::vector{"cat"s, "in"s, "the"s, "city"s}));
+
+    // Texts are longer than a vector register, so words cross the chunks the text is scanned by.
+    const std::string alphabet = "  ab\x7F\x01\xC3\xA9"s;
+    for (int i = 0; i < 1'000; ++i) {
+        std::string text(Generator<std::size_t>::Get(0, 100), ' ');
+        const bool is_clean = i % 2 == 0;
+        for (auto& c : text) {
+            c = alphabet[Generator<std::size_t>::Get(0, is_clean ? 3 : alphabet.size() - 1)];
+        }
+        bool has_control_chars = true;
+        ASSERT_EQUAL(SplitIntoWordsView(text, &has_control_chars), split_by_chars(text));
+        const bool answer = std::any_of(text.begin(), text.end(), [](const char c) {
+            return iscntrl(static_cast<unsigned char>(c));
+        });
+        ASSERT_EQUAL(has_control_chars, answer);
+        ASSERT_EQUAL(HasControlChars(text), answer);
+    }
+
+    const WordRange range(" cat  \x12in the "sv);
+    auto iter = range.begin();
+    ASSERT_EQUAL(*iter, "cat"sv);
+    ASSERT(!range.HasControlChars());
+    ASSERT_EQUAL(*++iter, "\x12in"sv);
+    ASSERT(range.HasControlChars());
+    ASSERT_EQUAL(std::distance(iter, range.end()), 2);
+
+    SearchServer server(""sv);
+    ASSERT_THROW(server.AddDocument(0, "cat \x12in the city"sv, DocumentStatus::ACTUAL, {1}), std::invalid_argument);
+    server.AddDocument(0, "cat in the city"sv, DocumentStatus::ACTUAL, {1});
+    ASSERT_EQUAL(server.GetWordFrequencies(0).size(), 4u);
+}
+
+inline void TestTermDictionary() {
+    TermDictionary dictionary;
+    const auto cat_id = dictionary.Intern("cat"sv);
+    const auto dog_id = dictionary.Intern("dog"sv);
+    ASSERT(cat_id != dog_id);
+    ASSERT_EQUAL(dictionary.Intern("cat"sv), cat_id);
+    ASSERT_EQUAL(dictionary.size(), 2u);
+    ASSERT_EQUAL(dictionary.GetTerm(dog_id), "dog"sv);
+    ASSERT(!dictionary.Find("bird"sv).has_value());
+
+    dictionary.Release(cat_id);
+    ASSERT(!dictionary.Find("cat"sv).has_value());
+    ASSERT_EQUAL_HINT(dictionary.Intern("bird"sv), cat_id, "Ids of released terms must be reused"s);
+    ASSERT_EQUAL(dictionary.GetIdBound(), 2u);
+    ASSERT_EQUAL(*dictionary.Find("bird"sv), cat_id);
+
+    {
+        auto original = std::make_unique<TermDictionary>(dictionary);
+        TermDictionary copy = *original;
+        TermDictionary assigned;
+        assigned.Intern("fish"sv);
+        assigned = *original;
+        original->Release(dog_id);
+        original.reset();
+        for (const auto* other : {&copy, &assigned}) {
+            ASSERT_EQUAL_HINT(*other->Find("dog"sv), dog_id, "A copy must not refer to terms of the original"s);
+            ASSERT_EQUAL(*other->Find("bird"sv), cat_id);
+            ASSERT(!other->Find("fish"sv).has_value());
+        }
+    }
+
+    // Free ids of a file must be the released terms, each exactly once.
+    const auto path = (std::filesystem::temp_directory_path() / "search_server_test.index"s).string();
+    const auto read_dictionary = [&path](const std::vector<std::string>& terms,
+                                         const std::vector<TermDictionary::TermId>& free_ids) {
+        {
+            index_file::IndexWriter writer(path);
+            writer.WriteStrings(terms);
+            writer.WriteArray(free_ids);
+            writer.Finish();
+        }
+        index_file::IndexReader reader(path);
+        return TermDictionary::Read(reader);
+    };
+    ASSERT_EQUAL(*read_dictionary({"cat"s, ""s, "dog"s}, {1}).Find("dog"sv), 2u);
+    ASSERT_THROW((void) read_dictionary({"cat"s, ""s}, {7}), std::invalid_argument);
+    ASSERT_THROW((void) read_dictionary({"cat"s, ""s, ""s}, {1, 1}), std::invalid_argument);
+    ASSERT_THROW((void) read_dictionary({"cat"s, ""s}, {0}), std::invalid_argument);
+    std::filesystem::remove(path);
+}
+
+inline void TestBitmap() {
+    Bitmap bitmap(10);
+    ASSERT_EQUAL(bitmap.size(), 10u);
+    ASSERT(!bitmap.Test(3));
+    ASSERT(!bitmap.Test(1'000));
+
+    bitmap.Set(3);
+    bitmap.Set(64);
+    bitmap.Set(200);
+    ASSERT(bitmap.Test(3) && bitmap.Test(64) && bitmap.Test(200));
+    ASSERT(!bitmap.Test(4) && !bitmap.Test(63) && !bitmap.Test(199));
+    ASSERT_EQUAL_HINT(bitmap.size(), 201u, "Setting a bit out of the size must grow the bitmap"s);
+
+    bitmap.Reset(64);
+    bitmap.Reset(1'000);
+    ASSERT(!bitmap.Test(64));
+    ASSERT(bitmap.Test(3));
+
+    // A file is rejected if a bit past the size is set.
+    const auto path = (std::filesystem::temp_directory_path() / "search_server_test.index"s).string();
+    const auto read_bitmap = [&path](std::uint64_t size, const std::vector<std::uint64_t>& words) {
+        {
+            index_file::IndexWriter writer(path);
+            writer.WriteValue(size);
+            writer.WriteArray(words);
+            writer.Finish();
+        }
+        index_file::IndexReader reader(path);
+        return Bitmap::Read(reader);
+    };
+    ASSERT(read_bitmap(10, {std::uint64_t{1} << 9}).Test(9));
+    ASSERT_THROW((void) read_bitmap(10, {std::uint64_t{1} << 10}), std::invalid_argument);
+    std::filesystem::remove(path);
 }
 
 template<typename T>
@@ -584,17 +1884,40 @@ inline void RunAllTests() {
     RUN_TEST(TestConstructors);
     RUN_TEST(TestRangeBasedForLoop);
     RUN_TEST(TestAddDocument);
+    RUN_TEST(TestAddDocuments);
     RUN_TEST(TestRemoveDocument);
+    RUN_TEST(TestCopySearchServer);
+    RUN_TEST(TestReAddRemovedDocument);
+    RUN_TEST(TestCompactIndex);
+    RUN_TEST(TestRemoveDocuments);
     RUN_TEST(TestGetWordFrequencies);
     RUN_TEST(TestExcludeStopWordsFromAddedDocumentContent);
     RUN_TEST(TestExcludeDocumentsWithMinusWords);
     RUN_TEST(TestMatchingDocuments);
+    RUN_TEST(TestBatchMatchingDocuments);
     RUN_TEST(TestSortingDocumentsByRelevance);
     RUN_TEST(TestDocumentRating);
     RUN_TEST(TestFindTopDocumentsWithPredicate);
     RUN_TEST(TestFindTopDocumentsWithSpecifiedStatus);
+    RUN_TEST(TestFindTopDocumentsResultCount);
+    RUN_TEST(TestDynamicPruning);
     RUN_TEST(TestCorrectnessRelevance);
     RUN_TEST(TestRemoveDuplicates);
+    RUN_TEST(TestIndexFile);
+    RUN_TEST(TestWriteAheadLog);
+    RUN_TEST(TestPostingListEncodings);
+    RUN_TEST(TestCompressedIndex);
+    RUN_TEST(TestSetIntersection);
+    RUN_TEST(TestSplitIntoWords);
+    RUN_TEST(TestTermDictionary);
+    RUN_TEST(TestBitmap);
+    RUN_TEST(TestTopK);
+    RUN_TEST(TestScoreAccumulator);
+    RUN_TEST(TestThreadPool);
+    RUN_TEST(TestResultCache);
+    RUN_TEST(TestShardedLruCache);
+    RUN_TEST(TestAdaptivePolicy);
+    RUN_TEST(TestPreparedQuery);
     RUN_TEST(TestPaginator);
     RUN_TEST(RunAllTestsFlattenContainer);
 }
\ No newline at end of file
@@ -0,0 +1,293 @@
+#include "write_ahead_log.h"
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std::string_literals;
+
+namespace {
+
+constexpr char MAGIC[8] = {'S', 'S', 'W', 'A', 'L', 'O', 'G', '\0'};
+constexpr std::uint32_t VERSION = 1;
+// Tells a log written on a machine with another byte order.
+constexpr std::uint32_t BYTE_ORDER_MARK = 0x01020304;
+constexpr std::size_t HEADER_SIZE = sizeof(MAGIC) + 2 * sizeof(std::uint32_t);
+// A record is its payload size and the checksum of the payload followed by the payload.
+constexpr std::size_t RECORD_HEADER_SIZE = 2 * sizeof(std::uint32_t);
+
+// CRC-32 (IEEE 802.3) computed byte by byte with a table.
+const std::array<std::uint32_t, 256> CRC_TABLE = [] {
+    std::array<std::uint32_t, 256> table{};
+    for (std::uint32_t i = 0; i < table.size(); ++i) {
+        std::uint32_t crc = i;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc & 1) != 0 ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+        }
+        table[i] = crc;
+    }
+    return table;
+}();
+
+[[nodiscard]] std::uint32_t ComputeCrc32(const char* data, std::size_t size) noexcept {
+    std::uint32_t crc = 0xFFFFFFFFu;
+    for (std::size_t i = 0; i < size; ++i) {
+        crc = CRC_TABLE[(crc ^ static_cast<unsigned char>(data[i])) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+template<typename T>
+void AppendValue(std::string& out, const T& value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+[[nodiscard]] std::string MakeHeader() {
+    std::string header(MAGIC, sizeof(MAGIC));
+    AppendValue(header, VERSION);
+    AppendValue(header, BYTE_ORDER_MARK);
+    return header;
+}
+
+// Reads values of a payload, reporting whether all of them were inside the payload.
+class PayloadReader {
+public:
+    PayloadReader(const char* data, std::size_t size) noexcept
+            : data_(data), size_(size) {
+    }
+
+    template<typename T>
+    [[nodiscard]] T Read() noexcept {
+        T value{};
+        if (sizeof(T) <= size_ - position_) {
+            std::memcpy(&value, data_ + position_, sizeof(T));
+            position_ += sizeof(T);
+        } else {
+            is_valid_ = false;
+        }
+        return value;
+    }
+
+    [[nodiscard]] std::string_view ReadText(std::size_t size) noexcept {
+        if (size <= size_ - position_) {
+            position_ += size;
+            return {data_ + position_ - size, size};
+        }
+        is_valid_ = false;
+        return {};
+    }
+
+    [[nodiscard]] bool IsValid() const noexcept {
+        return is_valid_ && position_ == size_;
+    }
+
+private:
+    const char* data_;
+    std::size_t size_;
+    std::size_t position_ = 0;
+    bool is_valid_ = true;
+};
+
+void CheckHeader(const std::string& content, const std::string& path) {
+    if (content.size() < HEADER_SIZE || content.compare(0, HEADER_SIZE, MakeHeader()) != 0) {
+        throw std::invalid_argument("Not a write-ahead log of the supported version: "s + path);
+    }
+}
+
+// Calls `func(record)` for the intact records after the header and returns the size of the intact part.
+template<typename Func>
+std::size_t ParseRecords(const std::string& content, Func func) {
+    using Record = WriteAheadLog::Record;
+    using RecordType = WriteAheadLog::RecordType;
+
+    std::size_t position = HEADER_SIZE;
+    while (RECORD_HEADER_SIZE <= content.size() - position) {
+        std::uint32_t payload_size;
+        std::uint32_t crc;
+        std::memcpy(&payload_size, content.data() + position, sizeof(payload_size));
+        std::memcpy(&crc, content.data() + position + sizeof(payload_size), sizeof(crc));
+        const char* payload = content.data() + position + RECORD_HEADER_SIZE;
+        if (payload_size > content.size() - position - RECORD_HEADER_SIZE
+                || ComputeCrc32(payload, payload_size) != crc) {
+            break;
+        }
+
+        PayloadReader reader(payload, payload_size);
+        Record record;
+        record.sequence_number = reader.Read<std::uint64_t>();
+        record.type = reader.Read<RecordType>();
+        record.document_id = reader.Read<std::int32_t>();
+        if (record.type == RecordType::ADD_DOCUMENT) {
+            record.status = reader.Read<DocumentStatus>();
+            if (static_cast<std::uint32_t>(record.status) > static_cast<std::uint32_t>(DocumentStatus::REMOVED)) {
+                break;
+            }
+            const auto rating_count = reader.Read<std::uint32_t>();
+            if (rating_count > payload_size / sizeof(std::int32_t)) {
+                break;
+            }
+            record.ratings.resize(rating_count);
+            for (auto& rating : record.ratings) {
+                rating = reader.Read<std::int32_t>();
+            }
+            record.text = reader.ReadText(reader.Read<std::uint32_t>());
+        } else if (record.type != RecordType::REMOVE_DOCUMENT) {
+            break;
+        }
+        if (!reader.IsValid()) {
+            break;
+        }
+        func(record);
+        position += RECORD_HEADER_SIZE + payload_size;
+    }
+    return position;
+}
+
+[[nodiscard]] std::string ReadFile(int fd, const std::string& path) {
+    std::string content;
+    char chunk[1 << 16];
+    while (true) {
+        const ssize_t size = read(fd, chunk, sizeof(chunk));
+        if (size < 0 && errno == EINTR) {
+            continue;
+        }
+        if (size < 0) {
+            throw std::runtime_error("Cannot read write-ahead log "s + path);
+        }
+        if (size == 0) {
+            return content;
+        }
+        content.append(chunk, static_cast<std::size_t>(size));
+    }
+}
+
+} // namespace
+
+WriteAheadLog::WriteAheadLog(const std::string& path, std::size_t group_commit_byte_count)
+        : group_commit_byte_count_(group_commit_byte_count) {
+    fd_ = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd_ < 0) {
+        throw std::runtime_error("Cannot open write-ahead log "s + path);
+    }
+    try {
+        const auto content = ReadFile(fd_, path);
+        std::size_t intact_size = 0;
+        if (content.empty()) {
+            buffer_ = MakeHeader();
+        } else {
+            CheckHeader(content, path);
+            intact_size = ParseRecords(content, [](const Record&) {});
+        }
+        // Cut off a record torn by a crash, so the following records are appended right after the intact ones.
+        if (ftruncate(fd_, static_cast<off_t>(intact_size)) != 0
+                || lseek(fd_, 0, SEEK_END) < 0) {
+            throw std::runtime_error("Cannot truncate write-ahead log "s + path);
+        }
+        CommitLocked();
+    } catch (...) {
+        close(fd_);
+        throw;
+    }
+}
+
+WriteAheadLog::~WriteAheadLog() {
+    try {
+        Commit();
+    } catch (...) {
+    }
+    close(fd_);
+}
+
+// Modification
+
+void WriteAheadLog::AppendAddDocument(std::uint64_t sequence_number, int document_id, std::string_view document,
+                                      DocumentStatus status, const std::vector<int>& ratings) {
+    std::string payload;
+    payload.reserve(32 + ratings.size() * sizeof(std::int32_t) + document.size());
+    AppendValue(payload, sequence_number);
+    AppendValue(payload, RecordType::ADD_DOCUMENT);
+    AppendValue(payload, static_cast<std::int32_t>(document_id));
+    AppendValue(payload, status);
+    AppendValue(payload, static_cast<std::uint32_t>(ratings.size()));
+    for (const int rating : ratings) {
+        AppendValue(payload, static_cast<std::int32_t>(rating));
+    }
+    AppendValue(payload, static_cast<std::uint32_t>(document.size()));
+    payload.append(document);
+    AppendRecord(payload);
+}
+
+void WriteAheadLog::AppendRemoveDocument(std::uint64_t sequence_number, int document_id) {
+    std::string payload;
+    AppendValue(payload, sequence_number);
+    AppendValue(payload, RecordType::REMOVE_DOCUMENT);
+    AppendValue(payload, static_cast<std::int32_t>(document_id));
+    AppendRecord(payload);
+}
+
+void WriteAheadLog::Commit() {
+    std::lock_guard guard(mutex_);
+    CommitLocked();
+}
+
+void WriteAheadLog::Truncate() {
+    std::lock_guard guard(mutex_);
+    buffer_ = MakeHeader();
+    if (ftruncate(fd_, 0) != 0 || lseek(fd_, 0, SEEK_SET) < 0) {
+        throw std::runtime_error("Cannot truncate write-ahead log"s);
+    }
+    CommitLocked();
+}
+
+void WriteAheadLog::AppendRecord(const std::string& payload) {
+    std::lock_guard guard(mutex_);
+    AppendValue(buffer_, static_cast<std::uint32_t>(payload.size()));
+    AppendValue(buffer_, ComputeCrc32(payload.data(), payload.size()));
+    buffer_ += payload;
+    if (buffer_.size() >= group_commit_byte_count_) {
+        CommitLocked();
+    }
+}
+
+void WriteAheadLog::CommitLocked() {
+    std::size_t written = 0;
+    while (written < buffer_.size()) {
+        const ssize_t size = write(fd_, buffer_.data() + written, buffer_.size() - written);
+        if (size < 0 && errno == EINTR) {
+            continue;
+        }
+        if (size < 0) {
+            // The records which weren't written completely are cut off as torn on reopening.
+            buffer_.erase(0, written);
+            throw std::runtime_error("Cannot write to write-ahead log"s);
+        }
+        written += static_cast<std::size_t>(size);
+    }
+    buffer_.clear();
+    if (fdatasync(fd_) != 0) {
+        throw std::runtime_error("Cannot sync write-ahead log"s);
+    }
+}
+
+// Reading
+
+void WriteAheadLog::ForEachRecord(const std::string& path, const std::function<void(const Record&)>& func) {
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open write-ahead log "s + path);
+    }
+    std::string content;
+    try {
+        content = ReadFile(fd, path);
+    } catch (...) {
+        close(fd);
+        throw;
+    }
+    close(fd);
+    CheckHeader(content, path);
+    (void) ParseRecords(content, func);
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "document.h"
+
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+/// Append-only log of the changes of documents, so the changes made after the last saved index
+/// survive a crash of the process.
+///
+/// Every record has a sequence number, which grows with every change, and a checksum.
+/// Records are buffered and written in groups: `Commit` writes all buffered records at once
+/// and makes them durable with a single `fdatasync`, which happens automatically as soon as
+/// `group_commit_byte_count` bytes are buffered. A crash loses only the records of the last
+/// uncommitted group; a record torn by the crash is cut off when the log is reopened.
+/// Appending and committing are safe to call from several threads.
+class WriteAheadLog {
+public:
+    inline static constexpr std::size_t DEFAULT_GROUP_COMMIT_BYTE_COUNT = 1 << 20;
+
+    enum class RecordType : std::uint8_t {
+        ADD_DOCUMENT = 1,
+        REMOVE_DOCUMENT = 2,
+    };
+
+    struct Record {
+        std::uint64_t sequence_number = 0;
+        RecordType type = RecordType::ADD_DOCUMENT;
+        int document_id = 0;
+        // The following fields are set only for `ADD_DOCUMENT`.
+        DocumentStatus status = DocumentStatus::ACTUAL;
+        std::vector<int> ratings;
+        std::string_view text;
+    };
+
+    /// Opens or creates the log for appending. Throws `std::runtime_error` if the file can't be opened
+    /// and `std::invalid_argument` if it isn't a log of the supported version.
+    explicit WriteAheadLog(const std::string& path,
+                           std::size_t group_commit_byte_count = DEFAULT_GROUP_COMMIT_BYTE_COUNT);
+
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+    /// Commits the buffered records; errors are ignored, call `Commit` to get them.
+    ~WriteAheadLog();
+
+    // Modification
+
+    void AppendAddDocument(std::uint64_t sequence_number, int document_id, std::string_view document,
+                           DocumentStatus status, const std::vector<int>& ratings);
+
+    void AppendRemoveDocument(std::uint64_t sequence_number, int document_id);
+
+    /// Writes the buffered records and waits until they are durable; throws `std::runtime_error` on failure.
+    void Commit();
+
+    /// Discards all records, for example, once the index with all their changes is saved.
+    void Truncate();
+
+    // Reading
+
+    /// Calls `func(record)` for every intact record of the log in order, stopping at a torn record.
+    /// The text of a record is valid only during the call.
+    static void ForEachRecord(const std::string& path, const std::function<void(const Record&)>& func);
+
+private:
+    std::mutex mutex_;
+    int fd_ = -1;
+    std::size_t group_commit_byte_count_;
+    std::string buffer_;
+
+    void AppendRecord(const std::string& payload);
+
+    void CommitLocked();
+};